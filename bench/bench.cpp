@@ -0,0 +1,615 @@
+// Benchmark of fade() and pwmControl() with the output quality for every combination of light type and CCT mode, of a 300 pixel strip
+// of the scalar and batch rendering of 4, 16 and 64 RGB lights and of the I2C load of 16 RGB lights on PCA9685 chips.
+// A soak test fires random command sequences at every light type and checks how the lights settle.
+// Synchronised transitions are checked with a simulated clock on two simulated devices.
+// Build with the *-bench environments or run it on the host with the fake Arduino core: make -C test bench
+// Results are printed as one JSON object per line, failed checks as {"fail":..} and the last line has their number:
+// {"light":"RGBCT","cct":"NORMAL","workload":"fade","ticks":1200,"ns_per_tick":..,"pwm_writes_per_tick":..,"callbacks_per_s":..,"flicker_percent":..,"max_step_lstar":..}
+#include <Arduino.h>
+#include "esp-knx-led.h"
+#include "esp-knx-led-strip.h"
+#include "esp-knx-led-batch.h"
+#include "esp-knx-led-pca9685.h"
+#include "esp-knx-led-analyzer.h"
+#include "esp-knx-led-trace.h"
+
+#if defined(ESP32)
+static const uint8_t pins[5] = {16, 17, 18, 19, 21};
+#else
+static const uint8_t pins[5] = {4, 5, 12, 13, 14};
+#endif
+
+#define SOAK_SEQUENCES 100
+#define SOAK_FADE_BOUND 512    // ticks of a transition to an absolute value, the longest is a hue change with saturation dip
+#define SOAK_DIMM_SPEED 6      // default dimmSpeed, ticks per step of relative dimming
+#define SOAK_SETTLE_BOUND 4096 // ticks after the last command until the sequence counts as not settled
+#define SOAK_IDLE_TICKS 16     // ticks after settling without any PWM write
+
+#define SYNC_DURATION 1000     // ms of the synchronised transitions
+#define SYNC_SAMPLES 64        // compared positions, one every SYNC_DURATION / 32 ms
+
+static const uint8_t analyzerChannels[5] = {0, 1, 2, 3, 4};
+
+static const char *lightNames[] = {"SWITCHABLE", "DIMMABLE", "TUNABLEWHITE", "RGB", "RGBW", "RGBCT"};
+static const char *cctNames[] = {"NORMAL", "BIPOLAR", "TEMP_CHANNEL"};
+
+enum Workload
+{
+	WORKLOAD_FADE,     // full range fade on and off
+	WORKLOAD_RELATIVE, // relative hue, temperature and brightness dimming
+	WORKLOAD_STORM,    // a new setpoint every few ticks
+	WORKLOAD_STORM_LINEAR // same as storm with INTERPOLATE_LINEAR color transitions
+};
+static const char *workloadNames[] = {"fade", "relative", "storm", "storm-linear"};
+
+uint16_t benchFailures = 0; // failed checks of the soak test and the sync check, the exit code of the host build
+
+// a failed check gets its own line, the last line has the number of failures
+static void benchFail(const char *check, const char *light, const char *cct, uint32_t value)
+{
+	benchFailures++;
+	Serial.printf("{\"fail\":\"%s\",\"light\":\"%s\",\"cct\":\"%s\",\"value\":%u}\n", check, light, cct, value);
+}
+
+void statusCallback(bool) {}
+void brightnessCallback(uint8_t) {}
+void temperatureCallback(uint16_t) {}
+void rgbCallback(rgb_t) {}
+void hsvCallback(hsv_t) {}
+
+static void initLight(KnxLed &led, KnxLed::LightTypes lightType, __cctMode cctMode, const uint8_t *pins = ::pins)
+{
+#if defined(ESP32)
+	// every light is benchmarked on its own, so the LEDC channels can be reused
+	nextEsp32LedChannel = LEDC_CHANNEL_0;
+#endif
+	switch (lightType)
+	{
+	case KnxLed::SWITCHABLE:
+		led.initSwitchableLight(pins[0]);
+		break;
+	case KnxLed::DIMMABLE:
+		led.initDimmableLight(pins[0]);
+		break;
+	case KnxLed::TUNABLEWHITE:
+		led.initTunableWhiteLight(pins[0], pins[1], cctMode);
+		break;
+	case KnxLed::RGB:
+		led.initRgbLight(pins[0], pins[1], pins[2]);
+		break;
+	case KnxLed::RGBW:
+		led.initRgbwLight(pins[0], pins[1], pins[2], pins[3], {255, 200, 150});
+		break;
+	case KnxLed::RGBCT:
+		led.initRgbcctLight(pins[0], pins[1], pins[2], pins[3], pins[4], cctMode);
+		break;
+	}
+	led.registerStatusCallback(statusCallback);
+	led.registerBrightnessCallback(brightnessCallback);
+	led.registerTemperatureCallback(temperatureCallback);
+	led.registerColorRgbCallback(rgbCallback);
+	led.registerColorHsvCallback(hsvCallback);
+}
+
+static uint32_t runTicks(KnxLed &led, uint16_t ticks, KnxLedAnalyzer *analyzer)
+{
+	for (uint16_t i = 0; i < ticks; i++)
+	{
+		led.loop();
+		if (analyzer != nullptr)
+		{
+			analyzer->tick();
+		}
+	}
+	return ticks;
+}
+
+static uint32_t runWorkload(KnxLed &led, Workload workload, KnxLedAnalyzer *analyzer = nullptr)
+{
+	uint32_t ticks = 0;
+	dpt3_t up;
+	up.fromDPT3(0b1001);
+	dpt3_t down;
+	down.fromDPT3(0b0001);
+	dpt3_t stop;
+	stop.fromDPT3(0);
+
+	switch (workload)
+	{
+	case WORKLOAD_FADE:
+		led.switchLight(true);
+		ticks += runTicks(led, 600, analyzer);
+		led.switchLight(false);
+		ticks += runTicks(led, 600, analyzer);
+		break;
+	case WORKLOAD_RELATIVE:
+		led.switchLight(true);
+		ticks += runTicks(led, 300, analyzer);
+		led.setRelHueCmd(up);
+		ticks += runTicks(led, 1536, analyzer);
+		led.setRelHueCmd(stop);
+		led.setRelTemperatureCmd(up);
+		ticks += runTicks(led, 1536, analyzer);
+		led.setRelTemperatureCmd(stop);
+		led.setRelDimmCmd(down);
+		ticks += runTicks(led, 1536, analyzer);
+		led.setRelDimmCmd(stop);
+		ticks += runTicks(led, 10, analyzer);
+		break;
+	case WORKLOAD_STORM_LINEAR:
+		led.configColorInterpolation(INTERPOLATE_LINEAR);
+		// fall through
+	case WORKLOAD_STORM:
+		randomSeed(1);
+		for (uint16_t i = 0; i < 1000; i++)
+		{
+			switch (random(3))
+			{
+			case 0:
+				led.setHsv({(uint8_t)random(256), (uint8_t)random(256), (uint8_t)random(256)});
+				break;
+			case 1:
+				led.setTemperature(random(2700, 6501));
+				break;
+			default:
+				led.setBrightness(random(256));
+				break;
+			}
+			ticks += runTicks(led, 3, analyzer);
+		}
+		break;
+	}
+	return ticks;
+}
+
+static void benchmark(KnxLed::LightTypes lightType, __cctMode cctMode, Workload workload)
+{
+	KnxLed led;
+	initLight(led, lightType, cctMode);
+	led.resetStats();
+	unsigned long start = micros();
+	uint32_t ticks = runWorkload(led, workload);
+	unsigned long duration = max(1UL, micros() - start);
+	knxled_stats_t stats = led.getStats();
+
+	// same workload again with the duty stream scored instead of written to the pins
+	KnxLed scored;
+	KnxLedAnalyzer analyzer(scored.getPwmFrequency(), scored.getPwmResolution());
+	scored.configOutput(&analyzer);
+	initLight(scored, lightType, cctMode, analyzerChannels);
+	// the second white channel of TEMP_CHANNEL lights sets the color temperature and doesn't carry light
+	if (cctMode == TEMP_CHANNEL && (lightType == KnxLed::TUNABLEWHITE || lightType == KnxLed::RGBCT))
+	{
+		analyzer.configLightChannels(~(1 << (lightType == KnxLed::TUNABLEWHITE ? 1 : 4)));
+	}
+	runWorkload(scored, workload, &analyzer);
+	output_quality_t quality = analyzer.getQuality();
+
+	Serial.printf("{\"light\":\"%s\",\"cct\":\"%s\",\"workload\":\"%s\",\"ticks\":%u,", lightNames[lightType], cctNames[cctMode], workloadNames[workload], ticks);
+	Serial.printf("\"ns_per_tick\":%u,\"max_ns_per_tick\":%u,", stats.meanTickCycles * 1000 / ESP.getCpuFreqMHz(), stats.maxTickCycles * 1000 / ESP.getCpuFreqMHz());
+	Serial.printf("\"pwm_writes_per_tick\":%.3f,\"callbacks_per_s\":%.1f,", (float)stats.pwmWrites / ticks, stats.callbacksFired * 1e6f / duration);
+	Serial.printf("\"flicker_percent\":%.0f,\"flicker_index\":%.3f,\"flicker_risk\":%u,", quality.flickerPercent, quality.flickerIndex, quality.flickerRisk);
+	Serial.printf("\"max_step_lstar\":%.2f,\"visible_steps\":%u,\"unevenness\":%.3f}\n", quality.maxStep, quality.visibleSteps, quality.unevenness);
+}
+
+// two segments of a 300 pixel RGBW strip, the frames are captured in RAM instead of being sent
+static void benchmarkStrip()
+{
+	KnxLedStrip strip(300, STRIP_SK6812_RGBW);
+	KnxLedStripCapture capture;
+	strip.begin(&capture);
+	KnxLed segments[2];
+	segments[0].initStripLight(strip, 0, 150);
+	segments[1].initStripLight(strip, 150, 150);
+
+	randomSeed(1);
+	uint32_t ticks = 0;
+	unsigned long start = micros();
+	for (uint16_t i = 0; i < 1000; i++)
+	{
+		segments[i % 2].setHsv({(uint8_t)random(256), (uint8_t)random(256), (uint8_t)random(256)});
+		for (uint8_t j = 0; j < 3; j++)
+		{
+			segments[0].loop();
+			segments[1].loop();
+			strip.loop();
+			ticks++;
+		}
+	}
+	unsigned long duration = max(1UL, micros() - start);
+	Serial.printf("{\"light\":\"STRIP\",\"pixels\":300,\"workload\":\"storm\",\"ticks\":%u,\"ns_per_tick\":%u,\"frames\":%u}\n", ticks, (uint32_t)((uint64_t)duration * 1000 / ticks), strip.getFrameCount());
+}
+
+// RGB lights rendered one by one or by KnxLedBatch, all lights fade to a new random color every 100 ticks
+static void benchmarkBatch(uint8_t lightCount, bool scalar)
+{
+	KnxLed *lights = new KnxLed[lightCount];
+	KnxLedBatch batch;
+	for (uint8_t i = 0; i < lightCount; i++)
+	{
+#if defined(ESP32)
+		// more lights than LEDC channels, the duties are written to the same channels
+		nextEsp32LedChannel = LEDC_CHANNEL_0;
+#endif
+		lights[i].initRgbLight(pins[0], pins[1], pins[2]);
+		batch.addLight(&lights[i]);
+	}
+	batch.configScalar(scalar);
+
+	randomSeed(1);
+	uint32_t ticks = 0;
+	unsigned long start = micros();
+	for (uint8_t round = 0; round < 10; round++)
+	{
+		for (uint8_t i = 0; i < lightCount; i++)
+		{
+			lights[i].setHsv({(uint8_t)random(256), (uint8_t)random(256), (uint8_t)random(128, 256)});
+		}
+		for (uint8_t j = 0; j < 100; j++)
+		{
+			batch.loop();
+			ticks++;
+		}
+	}
+	unsigned long duration = max(1UL, micros() - start);
+	Serial.printf("{\"light\":\"RGB\",\"lights\":%u,\"workload\":\"%s\",\"ticks\":%u,\"ns_per_light_tick\":%u}\n", lightCount, scalar ? "scalar" : "batch", ticks, (uint32_t)((uint64_t)duration * 1000 / ticks / lightCount));
+	delete[] lights;
+}
+
+// 16 RGB lights (48 channels) on 4 PCA9685 with 5 lights each, the I2C transactions are counted by a fake bus
+static void benchmarkPca9685(bool burst)
+{
+	KnxLedFakeI2cBus bus;
+	KnxLedPca9685 *chips[4];
+	for (uint8_t i = 0; i < 4; i++)
+	{
+		chips[i] = new KnxLedPca9685(&bus, 0x40 + i);
+		chips[i]->begin();
+		chips[i]->configBurstWrite(burst);
+	}
+	KnxLed lights[16];
+	for (uint8_t i = 0; i < 16; i++)
+	{
+		uint8_t channel = (i % 5) * 3;
+		lights[i].configOutput(chips[i / 5]);
+		lights[i].initRgbLight(channel, channel + 1, channel + 2);
+	}
+	bus.resetCounters();
+
+	randomSeed(1);
+	uint32_t ticks = 0;
+	for (uint8_t round = 0; round < 10; round++)
+	{
+		for (uint8_t i = 0; i < 16; i++)
+		{
+			lights[i].setHsv({(uint8_t)random(256), (uint8_t)random(256), (uint8_t)random(128, 256)});
+		}
+		for (uint8_t j = 0; j < 100; j++)
+		{
+			for (uint8_t i = 0; i < 16; i++)
+			{
+				lights[i].loop();
+			}
+			for (uint8_t i = 0; i < 4; i++)
+			{
+				chips[i]->flush();
+			}
+			ticks++;
+		}
+	}
+	Serial.printf("{\"light\":\"RGB\",\"lights\":16,\"output\":\"pca9685\",\"workload\":\"%s\",\"ticks\":%u,", burst ? "burst" : "per-channel", ticks);
+	Serial.printf("\"i2c_transactions_per_tick\":%.2f,\"i2c_bytes_per_tick\":%.1f}\n", (float)bus.getTransactions() / ticks, (float)bus.getBytes() / ticks);
+	for (uint8_t i = 0; i < 4; i++)
+	{
+		delete chips[i];
+	}
+}
+
+typedef struct
+{
+    uint32_t settleTicks; // after the last command, SOAK_SETTLE_BOUND if the light didn't settle
+    uint32_t bound;       // ticks after the last command the commands of the sequence may take
+    uint8_t reversals;    // direction changes of brightness, temperature, hue or value (not RGBCT) after the last command
+    uint32_t idleWrites;  // PWM writes after settling
+} soak_result_t;
+
+// sends a random command and returns the ticks it may take
+static uint16_t soakCommand(KnxLed &led)
+{
+	dpt3_t cmd;
+	cmd.fromDPT3((random(2) << 3) | random(1, 8));
+	uint16_t relativeTicks = (255 >> (cmd.steps - 1)) * SOAK_DIMM_SPEED + SOAK_FADE_BOUND;
+	switch (random(8))
+	{
+	case 0:
+		led.switchLight(random(2));
+		break;
+	case 1:
+		led.setBrightness(random(256));
+		break;
+	case 2:
+		led.setTemperature(random(2700, 6501));
+		break;
+	case 3:
+		led.setHsv({(uint8_t)random(256), (uint8_t)random(256), (uint8_t)random(256)});
+		break;
+	case 4:
+		led.setRelDimmCmd(cmd);
+		return relativeTicks;
+	case 5:
+		led.setRelTemperatureCmd(cmd);
+		return relativeTicks;
+	case 6:
+		led.setRelHueCmd(cmd);
+		return relativeTicks;
+	default:
+		led.setRelSaturationCmd(cmd);
+		return relativeTicks;
+	}
+	return SOAK_FADE_BOUND;
+}
+
+// direction of a value, a change against the last direction is a reversal
+static void soakDirection(int16_t diff, int8_t &direction, uint8_t &reversals)
+{
+	if (diff == 0)
+	{
+		return;
+	}
+	int8_t d = diff > 0 ? 1 : -1;
+	if (direction != 0 && d != direction)
+	{
+		reversals++;
+	}
+	direction = d;
+}
+
+// 1..4 random commands with random pauses, the sequence only depends on the seed
+static soak_result_t runSoakSequence(KnxLed::LightTypes lightType, __cctMode cctMode, uint32_t seed, KnxLedTrace *trace)
+{
+	soak_result_t result = {0, 0, 0, 0};
+	KnxLed led;
+	initLight(led, lightType, cctMode);
+	led.switchLight(true);
+	for (uint16_t i = 0; i < SOAK_SETTLE_BOUND && !led.isSettled(); i++)
+	{
+		led.loop();
+	}
+	led.attachTrace(trace);
+
+	randomSeed(seed);
+	uint8_t commands = random(1, 5);
+	for (uint8_t i = 0; i < commands; i++)
+	{
+		result.bound = max<uint32_t>(result.bound, soakCommand(led));
+		if (i < commands - 1)
+		{
+			uint16_t pause = random(50);
+			runTicks(led, pause, nullptr);
+			result.bound = result.bound > pause ? result.bound - pause : 0;
+		}
+	}
+
+	// the saturation dips on purpose during large hue changes, so it's not checked. The value of RGBCT lights is the
+	// color share of the cross-fade with the white channels after a mode change, only the brightness is monotonic
+	int8_t direction[4] = {0, 0, 0, 0};
+	hsv_t hsv = led.getHsv();
+	uint8_t brightness = led.getBrightness();
+	uint16_t temperature = led.getTemperature();
+	while (!led.isSettled() && result.settleTicks < SOAK_SETTLE_BOUND)
+	{
+		led.loop();
+		result.settleTicks++;
+		hsv_t nextHsv = led.getHsv();
+		soakDirection(led.getBrightness() - brightness, direction[0], result.reversals);
+		soakDirection(led.getTemperature() - temperature, direction[1], result.reversals);
+		soakDirection((int8_t)(nextHsv.h - hsv.h), direction[2], result.reversals);
+		if (lightType != KnxLed::RGBCT)
+		{
+			soakDirection(nextHsv.v - hsv.v, direction[3], result.reversals);
+		}
+		hsv = nextHsv;
+		brightness = led.getBrightness();
+		temperature = led.getTemperature();
+	}
+
+	uint32_t writes = led.getStats().pwmWrites;
+	runTicks(led, SOAK_IDLE_TICKS, nullptr);
+	result.idleWrites = led.getStats().pwmWrites - writes;
+	led.attachTrace(nullptr);
+	return result;
+}
+
+// Random command sequences for one light type. A sequence fails if it takes longer than its bound, if a value
+// changes its direction after the last command or if PWM writes happen after settling. Each kind of failure is
+// reported once per light type with the number of sequences (writes for idle_writes).
+// The slowest sequence relative to its bound is printed as trace entries
+// [tick, type, d0, d1, d2] (see KnxLedTrace), which can be replayed as a regression case.
+static void soak(KnxLed::LightTypes lightType, __cctMode cctMode)
+{
+	uint32_t maxTicks = 0;
+	uint32_t sumTicks = 0;
+	uint32_t slowestSeed = 0;
+	uint32_t slowestRatio = 0;
+	uint16_t overBound = 0;
+	uint16_t reversals = 0;
+	uint32_t idleWrites = 0;
+	for (uint32_t seed = 1; seed <= SOAK_SEQUENCES; seed++)
+	{
+		soak_result_t result = runSoakSequence(lightType, cctMode, seed, nullptr);
+		sumTicks += result.settleTicks;
+		maxTicks = max(maxTicks, result.settleTicks);
+		if (result.settleTicks > result.bound)
+		{
+			overBound++;
+		}
+		uint32_t ratio = result.settleTicks * 256 / max<uint32_t>(result.bound, 1);
+		if (ratio > slowestRatio)
+		{
+			slowestRatio = ratio;
+			slowestSeed = seed;
+		}
+		reversals += result.reversals > 0;
+		idleWrites += result.idleWrites;
+	}
+
+	Serial.printf("{\"soak\":\"%s\",\"cct\":\"%s\",\"sequences\":%u,\"max_settle_ticks\":%u,\"mean_settle_ticks\":%u,", lightNames[lightType], cctNames[cctMode], SOAK_SEQUENCES, maxTicks, sumTicks / SOAK_SEQUENCES);
+	Serial.printf("\"over_bound\":%u,\"with_reversals\":%u,\"idle_writes\":%u,\"slowest_seed\":%u,\"slowest_of_bound\":%.2f,\"slowest\":[", overBound, reversals, idleWrites, slowestSeed, slowestRatio / 256.0f);
+	KnxLedTrace trace(32, false);
+	runSoakSequence(lightType, cctMode, slowestSeed, &trace);
+	for (uint16_t i = 0; i < trace.getCount(); i++)
+	{
+		trace_entry_t entry = trace.getEntry(i);
+		Serial.printf("%s[%u,%u,%u,%u,%u]", i > 0 ? "," : "", entry.tick, entry.type, entry.data[0], entry.data[1], entry.data[2]);
+	}
+	Serial.printf("]}\n");
+	if (overBound > 0)
+	{
+		benchFail("over_bound", lightNames[lightType], cctNames[cctMode], overBound);
+	}
+	if (reversals > 0)
+	{
+		benchFail("with_reversals", lightNames[lightType], cctNames[cctMode], reversals);
+	}
+	if (idleWrites > 0)
+	{
+		benchFail("idle_writes", lightNames[lightType], cctNames[cctMode], idleWrites);
+	}
+}
+
+static uint32_t simulatedClock = 0;
+
+static uint32_t simulatedClockSource()
+{
+	return simulatedClock;
+}
+
+static uint32_t millisClockSource()
+{
+	return millis();
+}
+
+// One simulated device: its local clock starts at localStart, the shared clock is set from the same DPT 19 telegram on
+// every device and loop() runs every loopInterval ms. Two commands arrive at the same shared times on every device,
+// the second one with a common transition start in the future. The channel duties are sampled at fixed shared times.
+static void runSyncDevice(uint32_t localStart, uint16_t loopInterval, uint16_t samples[SYNC_SAMPLES][3])
+{
+	static const uint8_t dpt19[8] = {126, 10, 19, 12, 0, 0, 0x00, 0x00}; // 2026-10-19 12:00:00
+	simulatedClock = localStart;
+	KnxLed::configClockSource(simulatedClockSource);
+	KnxLed::setClockDpt19(dpt19);
+	uint32_t epoch = KnxLed::getClock();
+
+	KnxLed led;
+	initLight(led, KnxLed::RGB, NORMAL);
+	led.configSyncedTransition(SYNC_DURATION);
+	uint32_t firstCommand = epoch + 100;
+	uint32_t secondCommand = firstCommand + SYNC_DURATION / 2;
+	uint16_t sampleInterval = SYNC_DURATION / 32;
+	uint8_t sample = 0;
+	while (sample < SYNC_SAMPLES)
+	{
+		simulatedClock++;
+		uint32_t now = KnxLed::getClock();
+		if (now == firstCommand)
+		{
+			led.setHsv({0, 255, 255});
+		}
+		if (now == secondCommand)
+		{
+			led.setTransitionStart(secondCommand + SYNC_DURATION / 4);
+			led.setHsv({170, 255, 64});
+		}
+		bool sampleNow = now >= firstCommand && (now - firstCommand) % sampleInterval == 0;
+		// the positions only depend on the clock, so an extra loop() at the sample time doesn't change them
+		if (sampleNow || simulatedClock % loopInterval == 0)
+		{
+			led.loop();
+		}
+		if (sampleNow)
+		{
+			for (uint8_t ch = 0; ch < 3; ch++)
+			{
+				samples[sample][ch] = led.getChannelDuty(ch);
+			}
+			sample++;
+		}
+	}
+}
+
+// Same commands on two devices with different local clocks and loop() intervals. The transitions must show the
+// same duties at the same shared time, and they must move, otherwise the comparison proves nothing.
+static void syncCheck()
+{
+	static uint16_t first[SYNC_SAMPLES][3];
+	static uint16_t second[SYNC_SAMPLES][3];
+	runSyncDevice(0, 10, first);
+	runSyncDevice(123457, 17, second);
+	uint16_t maxDiff = 0;
+	uint8_t moving = 0;
+	for (uint8_t i = 0; i < SYNC_SAMPLES; i++)
+	{
+		for (uint8_t ch = 0; ch < 3; ch++)
+		{
+			maxDiff = max<uint16_t>(maxDiff, abs(first[i][ch] - second[i][ch]));
+		}
+		if (i > 0 && memcmp(first[i], first[i - 1], sizeof(first[i])) != 0)
+		{
+			moving++;
+		}
+	}
+	KnxLed::configClockSource(millisClockSource);
+	KnxLed::setClock(millis());
+	Serial.printf("{\"sync\":\"RGB\",\"samples\":%u,\"moving_samples\":%u,\"max_diff\":%u}\n", SYNC_SAMPLES, moving, maxDiff);
+	if (maxDiff != 0)
+	{
+		benchFail("sync_max_diff", "RGB", "NORMAL", maxDiff);
+	}
+	if (moving == 0)
+	{
+		benchFail("sync_moving_samples", "RGB", "NORMAL", moving);
+	}
+}
+
+void setup()
+{
+	Serial.begin(115200);
+	delay(1000);
+	for (uint8_t lightType = KnxLed::SWITCHABLE; lightType <= KnxLed::RGBCT; lightType++)
+	{
+		for (uint8_t cctMode = NORMAL; cctMode <= TEMP_CHANNEL; cctMode++)
+		{
+			for (uint8_t workload = WORKLOAD_FADE; workload <= WORKLOAD_STORM_LINEAR; workload++)
+			{
+				benchmark((KnxLed::LightTypes)lightType, (__cctMode)cctMode, (Workload)workload);
+				yield();
+			}
+		}
+	}
+	benchmarkStrip();
+	static const uint8_t batchSizes[] = {4, 16, 64};
+	for (uint8_t i = 0; i < 3; i++)
+	{
+		benchmarkBatch(batchSizes[i], true);
+		benchmarkBatch(batchSizes[i], false);
+		yield();
+	}
+	benchmarkPca9685(false);
+	benchmarkPca9685(true);
+	for (uint8_t lightType = KnxLed::SWITCHABLE; lightType <= KnxLed::RGBCT; lightType++)
+	{
+		// the CCT mode only matters for the white channels
+		uint8_t lastCctMode = lightType == KnxLed::TUNABLEWHITE || lightType == KnxLed::RGBCT ? TEMP_CHANNEL : NORMAL;
+		for (uint8_t cctMode = NORMAL; cctMode <= lastCctMode; cctMode++)
+		{
+			soak((KnxLed::LightTypes)lightType, (__cctMode)cctMode);
+			yield();
+		}
+	}
+	syncCheck();
+	Serial.printf("{\"done\":true,\"failures\":%u}\n", benchFailures);
+}
+
+void loop()
+{
+}
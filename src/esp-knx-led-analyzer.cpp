@@ -0,0 +1,150 @@
+#include "esp-knx-led-analyzer.h"
+
+KnxLedAnalyzer::KnxLedAnalyzer(uint32_t pwmFrequency, uint8_t pwmResolution)
+{
+	this->pwmFrequency = pwmFrequency;
+	this->pwmResolution = constrain(pwmResolution, 1, 16);
+	reset();
+}
+
+void KnxLedAnalyzer::configStepThreshold(float deltaL)
+{
+	stepThreshold = deltaL;
+}
+
+// bitmask, all channels by default. The other channels are not scored
+void KnxLedAnalyzer::configLightChannels(uint8_t mask)
+{
+	lightChannels = mask;
+}
+
+void KnxLedAnalyzer::write(uint8_t channel, uint16_t duty)
+{
+	if (channel < ANALYZER_CHANNELS)
+	{
+		this->duty[channel] = duty;
+	}
+}
+
+void KnxLedAnalyzer::reset()
+{
+	for (uint8_t i = 0; i < ANALYZER_CHANNELS; i++)
+	{
+		duty[i] = 0;
+		lastLightness[i] = 0;
+		direction[i] = 0;
+		lastChange[i] = 0;
+		lastRate[i] = 0;
+	}
+	memset(&quality, 0, sizeof(quality));
+	litTicks = 0;
+	flickerIndexSum = 0;
+	rateChanges = 0;
+	rateChangeSum = 0;
+}
+
+void KnxLedAnalyzer::tick()
+{
+	quality.ticks++;
+	bool lit = false;
+	float flickerIndex = 0;
+	for (uint8_t i = 0; i < ANALYZER_CHANNELS; i++)
+	{
+		if (!(lightChannels & (1 << i)))
+		{
+			continue;
+		}
+		float y = level(duty[i]);
+		if (y > 0)
+		{
+			lit = true;
+		}
+		// square wave: the light is above the mean y for y of the period, the flicker index is (1 - y) * y / y
+		if (y > 0 && y < 1)
+		{
+			quality.flickerPercent = 100;
+			flickerIndex = max(flickerIndex, 1 - y);
+		}
+
+		float l = lightness(y);
+		float step = l - lastLightness[i];
+		if (step == 0)
+		{
+			continue;
+		}
+		float size = fabsf(step);
+		quality.maxStep = max(quality.maxStep, size);
+		if (size > stepThreshold)
+		{
+			quality.visibleSteps++;
+		}
+
+		// the rate of a fade which steps every n ticks is the step size / n, the first change of a fade has none
+		int8_t stepDirection = step > 0 ? 1 : -1;
+		uint32_t gap = quality.ticks - lastChange[i];
+		float rate = 0;
+		if (stepDirection == direction[i] && gap <= ANALYZER_MAX_GAP)
+		{
+			rate = size / gap;
+			if (lastRate[i] > 0)
+			{
+				rateChanges++;
+				rateChangeSum += fabsf(rate - lastRate[i]) / max(rate, lastRate[i]);
+			}
+		}
+		direction[i] = stepDirection;
+		lastChange[i] = quality.ticks;
+		lastRate[i] = rate;
+		lastLightness[i] = l;
+	}
+	if (lit)
+	{
+		litTicks++;
+		flickerIndexSum += flickerIndex;
+	}
+}
+
+output_quality_t KnxLedAnalyzer::getQuality()
+{
+	output_quality_t result = quality;
+	result.flickerIndex = litTicks > 0 ? flickerIndexSum / litTicks : 0;
+	result.unevenness = rateChanges > 0 ? rateChangeSum / rateChanges : 0;
+
+	// recommended practice of IEEE 1789-2015: limits of the modulation depth in percent over the frequency
+	float f = pwmFrequency;
+	float noEffect = f < 90 ? 0.01f * f : (f < 3000 ? 0.0333f * f : 100);
+	float lowRisk = f < 90 ? 0.025f * f : (f < 1250 ? 0.08f * f : 100);
+	if (result.flickerPercent <= noEffect)
+	{
+		result.flickerRisk = FLICKER_NO_EFFECT;
+	}
+	else if (result.flickerPercent <= lowRisk)
+	{
+		result.flickerRisk = FLICKER_LOW_RISK;
+	}
+	else
+	{
+		result.flickerRisk = FLICKER_HIGH_RISK;
+	}
+	return result;
+}
+
+float KnxLedAnalyzer::lightness(float luminance)
+{
+	if (luminance <= 0.008856f)
+	{
+		return 903.3f * luminance;
+	}
+	return 116.0f * cbrtf(luminance) - 16.0f;
+}
+
+// the light gets 10 bit duties, a lower resolution drops the low bits like the PWM hardware would
+float KnxLedAnalyzer::level(uint16_t duty)
+{
+	if (pwmResolution >= 10)
+	{
+		return min(1.0f, duty / 1023.0f);
+	}
+	uint16_t maxDuty = (1 << pwmResolution) - 1;
+	return min(1.0f, (float)(duty >> (10 - pwmResolution)) / maxDuty);
+}
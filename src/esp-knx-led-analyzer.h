@@ -0,0 +1,65 @@
+#pragma once
+
+#include "esp-knx-led-output.h"
+
+#define ANALYZER_CHANNELS 5
+#define ANALYZER_STEP_THRESHOLD 1.0f // delta L*, about one just noticeable difference
+#define ANALYZER_MAX_GAP 64          // ticks, changes with a longer pause in between belong to different fades
+
+// flicker risk of IEEE 1789 for the modulation at the PWM frequency
+enum __flickerRisk
+{
+    FLICKER_NO_EFFECT,
+    FLICKER_LOW_RISK,
+    FLICKER_HIGH_RISK
+};
+
+typedef struct __outputQuality
+{
+    uint32_t ticks;
+    float flickerPercent;  // largest modulation depth of a channel, PWM is 100 % unless off or full on
+    float flickerIndex;    // mean over the lit ticks of the largest flicker index of a channel
+    uint8_t flickerRisk;   // __flickerRisk
+    float maxStep;         // largest change of CIE L* of a channel within one tick
+    uint32_t visibleSteps; // changes above the step threshold
+    float unevenness;      // mean relative change of the L* rate between consecutive changes of a fade, 0 = perfectly even
+} output_quality_t;
+
+// Output backend which scores the duty stream of a light instead of driving LEDs, see KnxLed::configOutput().
+// Call tick() after each loop() of the light. The duties are quantized to the PWM resolution before the analysis,
+// so the result shows the steps of a coarser PWM as well.
+class KnxLedAnalyzer : public KnxLedOutput
+{
+public:
+    KnxLedAnalyzer(uint32_t pwmFrequency, uint8_t pwmResolution = 10);
+
+    void configStepThreshold(float deltaL);
+    void configLightChannels(uint8_t mask); // channels which carry light, e.g. not the temperature channel of TEMP_CHANNEL
+
+    void write(uint8_t channel, uint16_t duty);
+    void tick();
+    void reset();
+    output_quality_t getQuality();
+
+    static float lightness(float luminance); // CIE L* 0..100 of a relative luminance 0..1
+
+private:
+    uint32_t pwmFrequency;
+    uint8_t pwmResolution;
+    float stepThreshold = ANALYZER_STEP_THRESHOLD;
+    uint8_t lightChannels = (1 << ANALYZER_CHANNELS) - 1;
+
+    uint16_t duty[ANALYZER_CHANNELS];
+    float lastLightness[ANALYZER_CHANNELS];
+    int8_t direction[ANALYZER_CHANNELS];    // of the last change
+    uint32_t lastChange[ANALYZER_CHANNELS]; // tick
+    float lastRate[ANALYZER_CHANNELS];      // L* per tick of the last change, 0 = first change of a fade
+
+    output_quality_t quality;
+    uint32_t litTicks;
+    float flickerIndexSum;
+    uint32_t rateChanges;
+    float rateChangeSum;
+
+    float level(uint16_t duty); // relative luminance of a duty at the PWM resolution
+};
@@ -0,0 +1,97 @@
+#include "esp-knx-led-batch.h"
+
+bool KnxLedBatch::addLight(KnxLed *light)
+{
+	if (lightCount >= BATCH_MAX_LIGHTS)
+	{
+		return false;
+	}
+	lights[lightCount++] = light;
+	return true;
+}
+
+void KnxLedBatch::configScalar(bool scalar)
+{
+	this->scalar = scalar;
+}
+
+void KnxLedBatch::loop()
+{
+	if (scalar)
+	{
+		for (uint8_t i = 0; i < lightCount; i++)
+		{
+			lights[i]->loop();
+		}
+		return;
+	}
+
+	uint8_t count = 0;
+	KnxLed::renderBatch = this;
+	for (uint8_t i = 0; i < lightCount; i++)
+	{
+		KnxLed *light = lights[i];
+		deferred = false;
+		light->loop();
+		if (!deferred)
+		{
+			continue;
+		}
+		if (light->lightType == KnxLed::RGB)
+		{
+			index[count] = i;
+			h[count] = light->actHsv.h;
+			s[count] = light->actHsv.s;
+			v[count] = light->actHsv.v;
+			count++;
+		}
+		else
+		{
+			light->pwmControl();
+		}
+	}
+	KnxLed::renderBatch = nullptr;
+
+	if (count > 0)
+	{
+		hsv2rgb(count);
+		writeOutputs(count);
+	}
+}
+
+// Integer HSV to RGB without branches: channel = v - v * s * x with x = clamp(min(k, 4 - k), 0, 1)
+// and k = (n + h * 6 / 255) mod 6 for n = 5 (red), 3 (green) and 1 (blue), in units of 1/256.
+// 1542 / 256 is 6 / 255 * 256 and 257 / 2^24 is 1 / (255 * 256), the result matches KnxLed::hsv2rgb() within one step.
+void KnxLedBatch::hsv2rgb(uint8_t count)
+{
+	for (uint8_t i = 0; i < count; i++)
+	{
+		int32_t h6 = (h[i] * 1542 + 128) >> 8;
+		uint32_t vs = v[i] * s[i];
+		int32_t kr = (5 * 256 + h6) % 1536;
+		int32_t kg = (3 * 256 + h6) % 1536;
+		int32_t kb = (1 * 256 + h6) % 1536;
+		int32_t xr = max<int32_t>(0, min<int32_t>(256, min<int32_t>(kr, 1024 - kr)));
+		int32_t xg = max<int32_t>(0, min<int32_t>(256, min<int32_t>(kg, 1024 - kg)));
+		int32_t xb = max<int32_t>(0, min<int32_t>(256, min<int32_t>(kb, 1024 - kb)));
+		red[i] = v[i] - ((vs * xr * 257 + (1 << 23)) >> 24);
+		green[i] = v[i] - ((vs * xg * 257 + (1 << 23)) >> 24);
+		blue[i] = v[i] - ((vs * xb * 257 + (1 << 23)) >> 24);
+	}
+}
+
+void KnxLedBatch::writeOutputs(uint8_t count)
+{
+	for (uint8_t i = 0; i < count; i++)
+	{
+		KnxLed *light = lights[index[i]];
+		light->ledAnalogWrite(0, light->curveDuty(red[i]));
+		light->ledAnalogWrite(1, light->curveDuty(green[i]));
+		light->ledAnalogWrite(2, light->curveDuty(blue[i]));
+		if (light->latchedUpdate && light->latchedAutoCommit)
+		{
+			light->commitPwm();
+		}
+		light->rewriteOutputs = false;
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "esp-knx-led.h"
+
+#define BATCH_MAX_LIGHTS 64
+
+// Runs the loop() of a group of lights and converts the colors of all RGB lights which changed in one pass.
+// The actual HSV values are gathered into arrays, converted with branch free integer math which the compiler
+// can vectorize, and then written to the outputs. All other light types are rendered by pwmControl() as usual.
+class KnxLedBatch
+{
+    friend class KnxLed;
+
+public:
+    bool addLight(KnxLed *light);
+    void configScalar(bool scalar); // render each light on its own, e.g. for comparison
+
+    void loop(); // instead of the loop() of the lights
+
+private:
+    KnxLed *lights[BATCH_MAX_LIGHTS];
+    uint8_t lightCount = 0;
+    bool scalar = false;
+    bool deferred = false; // set by a light whose outputs have to be updated
+
+    // structure of arrays of the lights converted in one pass
+    uint8_t index[BATCH_MAX_LIGHTS];
+    uint8_t h[BATCH_MAX_LIGHTS];
+    uint8_t s[BATCH_MAX_LIGHTS];
+    uint8_t v[BATCH_MAX_LIGHTS];
+    uint8_t red[BATCH_MAX_LIGHTS];
+    uint8_t green[BATCH_MAX_LIGHTS];
+    uint8_t blue[BATCH_MAX_LIGHTS];
+
+    void hsv2rgb(uint8_t count);
+    void writeOutputs(uint8_t count);
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Output channels of a light which are not driven by the PWM of the SoC, see KnxLed::configOutput().
+// The output pins passed to the init functions of the light are the channel numbers of the backend.
+class KnxLedOutput
+{
+public:
+    virtual ~KnxLedOutput() {}
+    virtual void write(uint8_t channel, uint16_t duty) = 0; // 10 bit duty
+};
@@ -0,0 +1,198 @@
+#include "esp-knx-led-pca9685.h"
+
+KnxLedWireBus::KnxLedWireBus(TwoWire &wire) : wire(wire)
+{
+}
+
+bool KnxLedWireBus::write(uint8_t address, uint8_t reg, const uint8_t *data, size_t length)
+{
+	wire.beginTransmission(address);
+	wire.write(reg);
+	wire.write(data, length);
+	return wire.endTransmission() == 0;
+}
+
+// only the size of the transaction is counted
+bool KnxLedFakeI2cBus::write(uint8_t, uint8_t, const uint8_t *, size_t length)
+{
+	transactions++;
+	bytes += 2 + length;
+	return true;
+}
+
+uint32_t KnxLedFakeI2cBus::getTransactions()
+{
+	return transactions;
+}
+
+uint32_t KnxLedFakeI2cBus::getBytes()
+{
+	return bytes;
+}
+
+void KnxLedFakeI2cBus::resetCounters()
+{
+	transactions = 0;
+	bytes = 0;
+}
+
+KnxLedPca9685::KnxLedPca9685(KnxLedI2cBus *bus, uint8_t address)
+{
+	this->bus = bus;
+	this->address = address;
+	memset(registers, 0, sizeof(registers));
+}
+
+bool KnxLedPca9685::begin(uint16_t frequency)
+{
+	// the prescaler can only be written while the oscillator is off
+	uint8_t prescale = constrain((PCA9685_OSCILLATOR + 2048L * frequency) / (4096L * frequency) - 1, 3, 255);
+	uint8_t sleep = 0x10;
+	uint8_t wake = 0x20; // auto-increment
+	uint8_t restart = 0xA0;
+	if (!bus->write(address, PCA9685_MODE1, &sleep, 1) || !bus->write(address, PCA9685_PRESCALE, &prescale, 1) || !bus->write(address, PCA9685_MODE1, &wake, 1))
+	{
+		return false;
+	}
+	delayMicroseconds(500); // oscillator startup
+	if (!bus->write(address, PCA9685_MODE1, &restart, 1))
+	{
+		return false;
+	}
+	// all channels off
+	for (uint8_t i = 0; i < PCA9685_CHANNELS; i++)
+	{
+		registers[active][i * 4 + 3] = 0x10;
+	}
+	send(registers[active], 0, PCA9685_CHANNELS - 1);
+	memcpy(registers[active ^ 1], registers[active], sizeof(registers[0]));
+	return true;
+}
+
+void KnxLedPca9685::configBurstWrite(bool burst)
+{
+	this->burst = burst;
+}
+
+#if defined(ESP32)
+bool KnxLedPca9685::configAsync(bool async)
+{
+	if (async && task == nullptr)
+	{
+		// given while the send buffer is free, taken by flush() and given back by the task after the burst
+		idle = xSemaphoreCreateBinary();
+		if (idle == nullptr)
+		{
+			return false;
+		}
+		xSemaphoreGive(idle);
+		if (xTaskCreate(sendTask, "pca9685", 2048, this, 1, &task) != pdPASS)
+		{
+			vSemaphoreDelete(idle);
+			idle = nullptr;
+			task = nullptr;
+			return false;
+		}
+		return true;
+	}
+	// flush() sends directly again once the running burst is finished
+	if (!async && task != nullptr)
+	{
+		xSemaphoreTake(idle, portMAX_DELAY);
+		vTaskDelete(task);
+		vSemaphoreDelete(idle);
+		task = nullptr;
+		idle = nullptr;
+	}
+	return true;
+}
+
+void KnxLedPca9685::sendTask(void *parameter)
+{
+	KnxLedPca9685 *pca = (KnxLedPca9685 *)parameter;
+	for (;;)
+	{
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		pca->send(pca->registers[pca->active ^ 1], pca->sendFirst, pca->sendLast);
+		xSemaphoreGive(pca->idle);
+	}
+}
+#endif
+
+// 10 bit duty to 12 bit. The channels start staggered within the PWM period to spread the switching current.
+void KnxLedPca9685::write(uint8_t channel, uint16_t duty)
+{
+	if (channel >= PCA9685_CHANNELS)
+	{
+		return;
+	}
+	uint16_t on = channel * 256;
+	uint16_t off;
+	if (duty == 0)
+	{
+		on = 0;
+		off = 0x1000; // full off
+	}
+	else if (duty >= 1023)
+	{
+		on = 0x1000; // full on
+		off = 0;
+	}
+	else
+	{
+		off = (on + ((duty << 2) | (duty >> 8))) & 0x0FFF;
+	}
+
+	uint8_t *reg = registers[active] + channel * 4;
+	if (reg[0] == lowByte(on) && reg[1] == highByte(on) && reg[2] == lowByte(off) && reg[3] == highByte(off))
+	{
+		return;
+	}
+	reg[0] = lowByte(on);
+	reg[1] = highByte(on);
+	reg[2] = lowByte(off);
+	reg[3] = highByte(off);
+
+	if (!burst)
+	{
+		send(registers[active], channel, channel);
+		return;
+	}
+	dirtyFirst = min(dirtyFirst, channel);
+	dirtyLast = max(dirtyLast, channel);
+}
+
+void KnxLedPca9685::flush()
+{
+	if (dirtyFirst > dirtyLast)
+	{
+		return;
+	}
+#if defined(ESP32)
+	if (task != nullptr)
+	{
+		// the previous burst is still running, the changes are sent with the next flush()
+		if (xSemaphoreTake(idle, 0) != pdTRUE)
+		{
+			return;
+		}
+		sendFirst = dirtyFirst;
+		sendLast = dirtyLast;
+		active ^= 1;
+		memcpy(registers[active], registers[active ^ 1], sizeof(registers[0]));
+		dirtyFirst = PCA9685_CHANNELS;
+		dirtyLast = 0;
+		xTaskNotifyGive(task);
+		return;
+	}
+#endif
+	send(registers[active], dirtyFirst, dirtyLast);
+	dirtyFirst = PCA9685_CHANNELS;
+	dirtyLast = 0;
+}
+
+// unchanged channels between the first and last changed one are sent again, which is still less than a transaction each
+void KnxLedPca9685::send(const uint8_t *buffer, uint8_t first, uint8_t last)
+{
+	bus->write(address, PCA9685_LED0_ON_L + first * 4, buffer + first * 4, (last - first + 1) * 4);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "esp-knx-led-output.h"
+#include <Wire.h>
+
+#define PCA9685_CHANNELS 16
+#define PCA9685_MODE1 0x00
+#define PCA9685_LED0_ON_L 0x06 // 4 registers per channel: ON_L, ON_H, OFF_L, OFF_H
+#define PCA9685_PRESCALE 0xFE
+#define PCA9685_OSCILLATOR 25000000
+
+// Write access to an I2C bus, one call is one transaction: start, address, register, data, stop
+class KnxLedI2cBus
+{
+public:
+    virtual ~KnxLedI2cBus() {}
+    virtual bool write(uint8_t address, uint8_t reg, const uint8_t *data, size_t length) = 0;
+};
+
+class KnxLedWireBus : public KnxLedI2cBus
+{
+public:
+    KnxLedWireBus(TwoWire &wire = Wire);
+
+    bool write(uint8_t address, uint8_t reg, const uint8_t *data, size_t length);
+
+private:
+    TwoWire &wire;
+};
+
+// Counts the transactions and bytes instead of sending them, e.g. to compare the bus load of setups on the host
+class KnxLedFakeI2cBus : public KnxLedI2cBus
+{
+public:
+    bool write(uint8_t address, uint8_t reg, const uint8_t *data, size_t length);
+
+    uint32_t getTransactions();
+    uint32_t getBytes(); // address, register and data bytes
+    void resetCounters();
+
+private:
+    uint32_t transactions = 0;
+    uint32_t bytes = 0;
+};
+
+// PCA9685 16 channel 12 bit PWM controller as output of one or more lights, see KnxLed::configOutput().
+// write() only updates the register copy in RAM, flush() sends all channels changed since the last flush()
+// in one auto-increment burst. Call flush() once per tick after the loop() of the lights.
+class KnxLedPca9685 : public KnxLedOutput
+{
+public:
+    KnxLedPca9685(KnxLedI2cBus *bus, uint8_t address = 0x40);
+
+    bool begin(uint16_t frequency = 1000); // Hz, 24..1526
+    void configBurstWrite(bool burst);     // false: one transaction per written channel, e.g. for comparison
+#if defined(ESP32)
+    // flush() hands the registers to a task which sends them, the next tick is written to a second buffer.
+    // Changes are sent with the next flush() while the previous burst is still running.
+    bool configAsync(bool async);
+#endif
+
+    void write(uint8_t channel, uint16_t duty);
+    void flush();
+
+private:
+    KnxLedI2cBus *bus;
+    uint8_t address;
+    bool burst = true;
+    uint8_t registers[2][PCA9685_CHANNELS * 4];
+    uint8_t active = 0; // buffer written by write()
+    uint8_t dirtyFirst = PCA9685_CHANNELS;
+    uint8_t dirtyLast = 0;
+
+#if defined(ESP32)
+    TaskHandle_t task = nullptr;
+    SemaphoreHandle_t idle = nullptr; // taken while the task sends the other buffer
+    uint8_t sendFirst;
+    uint8_t sendLast;
+    static void sendTask(void *parameter);
+#endif
+
+    void send(const uint8_t *buffer, uint8_t first, uint8_t last);
+};
@@ -0,0 +1,212 @@
+#include "esp-knx-led-schedule.h"
+
+KnxLedSchedule::~KnxLedSchedule()
+{
+	delete[] table;
+}
+
+// The points are connected by smoothstep curves, from the last point of the day to the first one of the next day.
+// A single point gives constant values.
+bool KnxLedSchedule::configProfile(const schedule_point_t *points, uint8_t count)
+{
+	if (count == 0 || count > SCHEDULE_MAX_POINTS || points[count - 1].minute >= 1440)
+	{
+		return false;
+	}
+	for (uint8_t i = 1; i < count; i++)
+	{
+		if (points[i].minute <= points[i - 1].minute)
+		{
+			return false;
+		}
+	}
+	if (table == nullptr)
+	{
+		table = new schedule_slot_t[SCHEDULE_SLOTS];
+	}
+
+	for (uint16_t slot = 0; slot < SCHEDULE_SLOTS; slot++)
+	{
+		int32_t minute = slot * 1440L / SCHEDULE_SLOTS;
+		// last point at or before this minute, the last point of the previous day if there is none
+		uint8_t i = count - 1;
+		for (uint8_t k = 0; k < count && points[k].minute <= minute; k++)
+		{
+			i = k;
+		}
+		uint8_t j = (i + 1) % count;
+		int32_t start = points[i].minute > minute ? points[i].minute - 1440 : points[i].minute;
+		int32_t end = points[j].minute <= start ? points[j].minute + 1440 : points[j].minute;
+
+		float t = (float)(minute - start) / (end - start);
+		t = t * t * (3 - 2 * t);
+		const schedule_point_t &a = points[i];
+		const schedule_point_t &b = points[j];
+		table[slot].temperature = a.temperature + (b.temperature - a.temperature) * t + 0.5f;
+		table[slot].brightness = a.brightness == 0 || b.brightness == 0 ? a.brightness : a.brightness + (b.brightness - a.brightness) * t + 0.5f;
+	}
+	valuesValid = false;
+	return true;
+}
+
+void KnxLedSchedule::configResumeAfter(uint32_t ms)
+{
+	resumeAfter = ms;
+}
+
+bool KnxLedSchedule::attach(KnxLed *light)
+{
+	if (light == nullptr || lightCount >= SCHEDULE_MAX_LIGHTS || light->lightType == KnxLed::SWITCHABLE)
+	{
+		return false;
+	}
+	for (uint8_t i = 0; i < lightCount; i++)
+	{
+		if (lights[i].light == light)
+		{
+			return true;
+		}
+	}
+	schedule_light_t &entry = lights[lightCount++];
+	entry.light = light;
+	entry.overrideSince = 0;
+	entry.reportedTemperature = light->setpointTemperature;
+	entry.reportedBrightness = light->setpointBrightness;
+	entry.overridden = false;
+	light->scheduleOverride = false;
+	return true;
+}
+
+// Time of day from the application, e.g. a NTP client. It's continued with millis() and should be updated at least
+// every 49 days. The shared clock of KnxLed isn't used, KnxLed::setClock() would move the time of day
+void KnxLedSchedule::setTimeOfDay(uint32_t ms)
+{
+	timeOfDay = ms % MS_PER_DAY;
+	clockAnchor = millis();
+	timeValid = true;
+	valuesValid = false;
+}
+
+// DPT 10.001: day of week (3 bit) and hour (5 bit), minutes, seconds
+bool KnxLedSchedule::setTimeDpt10(const uint8_t *dpt10)
+{
+	uint8_t hour = dpt10[0] & 0x1F;
+	uint8_t minute = dpt10[1] & 0x3F;
+	uint8_t second = dpt10[2] & 0x3F;
+	if (hour > 23 || minute > 59 || second > 59)
+	{
+		return false;
+	}
+	setTimeOfDay((hour * 3600UL + minute * 60UL + second) * 1000);
+	return true;
+}
+
+// Follow the curve again. The light is set to the current values with the usual feedback and tunable white
+// lights go back to the color temperature mode.
+void KnxLedSchedule::resume(KnxLed *light)
+{
+	for (uint8_t i = 0; i < lightCount; i++)
+	{
+		schedule_light_t &entry = lights[i];
+		if (light != nullptr && entry.light != light)
+		{
+			continue;
+		}
+		entry.overridden = false;
+		if (valuesValid)
+		{
+			if (entry.light->lightType >= KnxLed::TUNABLEWHITE && entry.light->lightType != KnxLed::RGB)
+			{
+				entry.light->setTemperature(temperature);
+				entry.reportedTemperature = entry.light->setpointTemperature;
+			}
+			if (brightness > 0 && entry.light->getSwitchState())
+			{
+				entry.light->setBrightness(brightness);
+				entry.reportedBrightness = brightness;
+			}
+		}
+		// the commands above are no manual override
+		entry.light->scheduleOverride = false;
+	}
+}
+
+bool KnxLedSchedule::isOverridden(KnxLed *light)
+{
+	for (uint8_t i = 0; i < lightCount; i++)
+	{
+		if (lights[i].light == light)
+		{
+			return lights[i].overridden || light->scheduleOverride;
+		}
+	}
+	return false;
+}
+
+// linear between the precomputed slots, so the values change continuously
+bool KnxLedSchedule::getValues(uint32_t msOfDay, uint16_t &temperature, uint8_t &brightness)
+{
+	if (table == nullptr)
+	{
+		return false;
+	}
+	const uint32_t slotLength = MS_PER_DAY / SCHEDULE_SLOTS;
+	msOfDay %= MS_PER_DAY;
+	uint16_t slot = msOfDay / slotLength;
+	const schedule_slot_t &a = table[slot];
+	const schedule_slot_t &b = table[(slot + 1) % SCHEDULE_SLOTS];
+	int32_t p = (msOfDay % slotLength) * 256 / slotLength;
+	temperature = a.temperature + (((b.temperature - a.temperature) * p) >> 8);
+	brightness = a.brightness == 0 || b.brightness == 0 ? a.brightness : a.brightness + (((b.brightness - a.brightness) * p) >> 8);
+	return true;
+}
+
+void KnxLedSchedule::loop()
+{
+	if (table == nullptr || !timeValid)
+	{
+		return;
+	}
+	uint32_t now = millis();
+	if (!valuesValid || now - lastUpdate >= SCHEDULE_UPDATE_INTERVAL)
+	{
+		lastUpdate = now;
+		valuesValid = getValues(timeOfDay + (now - clockAnchor) % MS_PER_DAY, temperature, brightness);
+	}
+	// the lights are updated in every loop, so a light which was just switched on gets the values right away
+	for (uint8_t i = 0; i < lightCount; i++)
+	{
+		follow(lights[i]);
+	}
+}
+
+void KnxLedSchedule::follow(schedule_light_t &entry)
+{
+	KnxLed *light = entry.light;
+	if (light->scheduleOverride)
+	{
+		light->scheduleOverride = false;
+		entry.overridden = true;
+		entry.overrideSince = lastUpdate;
+	}
+	if (entry.overridden)
+	{
+		if (resumeAfter == 0 || lastUpdate - entry.overrideSince < resumeAfter)
+		{
+			return;
+		}
+		resume(light);
+	}
+
+	light->followSchedule(temperature, brightness);
+	if (abs(light->setpointTemperature - entry.reportedTemperature) >= SCHEDULE_FEEDBACK_TEMPERATURE)
+	{
+		entry.reportedTemperature = light->setpointTemperature;
+		light->returnTemperature();
+	}
+	if (light->setpointBrightness > 0 && abs(light->setpointBrightness - entry.reportedBrightness) >= SCHEDULE_FEEDBACK_BRIGHTNESS)
+	{
+		entry.reportedBrightness = light->setpointBrightness;
+		light->returnBrightness();
+	}
+}
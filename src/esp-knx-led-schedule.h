@@ -0,0 +1,75 @@
+#pragma once
+
+#include "esp-knx-led.h"
+
+#define SCHEDULE_MAX_POINTS 16
+#define SCHEDULE_MAX_LIGHTS 16
+#define SCHEDULE_SLOTS 96                 // precomputed values per day, one every 15 minutes
+#define SCHEDULE_UPDATE_INTERVAL 1000     // ms between two evaluations of the curve
+#define SCHEDULE_FEEDBACK_TEMPERATURE 100 // K change before the temperature is reported again
+#define SCHEDULE_FEEDBACK_BRIGHTNESS 5    // brightness change before it is reported again
+#define MS_PER_DAY 86400000UL
+
+typedef struct __schedulePoint
+{
+    uint16_t minute;      // of the day, 0..1439
+    uint16_t temperature; // K, 2700..6500
+    uint8_t brightness;   // 0 = brightness is not changed by the schedule
+} schedule_point_t;
+
+typedef struct __scheduleSlot
+{
+    uint16_t temperature;
+    uint8_t brightness;
+} schedule_slot_t;
+
+typedef struct __scheduleLight
+{
+    KnxLed *light;
+    uint32_t overrideSince;      // millis() of the last manual command
+    uint16_t reportedTemperature;
+    uint8_t reportedBrightness;
+    bool overridden;
+} schedule_light_t;
+
+// Daily color temperature and brightness curve for tunable white lights. The profile points are smoothly
+// interpolated into a table by configProfile(), loop() interpolates between the table slots with its own time of day
+// and hands the values to the fade engine of the lights, so no telegrams are needed.
+// Each manual command to a light except switching it on or off overrides the schedule for this light until
+// resume() or the configured resume time. Lights which are off follow the color temperature, the brightness is
+// taken over after switching on. RGB lights only follow the brightness.
+class KnxLedSchedule
+{
+public:
+    ~KnxLedSchedule();
+
+    bool configProfile(const schedule_point_t *points, uint8_t count); // sorted by minute
+    void configResumeAfter(uint32_t ms);                               // 0 = override until resume()
+    bool attach(KnxLed *light);
+
+    void setTimeOfDay(uint32_t ms);
+    bool setTimeDpt10(const uint8_t *dpt10); // KNX DPT 10.001, 3 bytes
+
+    void resume(KnxLed *light = nullptr); // nullptr = all lights
+    bool isOverridden(KnxLed *light);
+    bool getValues(uint32_t msOfDay, uint16_t &temperature, uint8_t &brightness);
+
+    void loop(); // call in every loop(), next to the loop() of the lights
+
+private:
+    schedule_slot_t *table = nullptr;
+    schedule_light_t lights[SCHEDULE_MAX_LIGHTS];
+    uint8_t lightCount = 0;
+    uint32_t resumeAfter = 0;
+
+    bool timeValid = false;
+    uint32_t timeOfDay;   // ms since midnight at clockAnchor
+    uint32_t clockAnchor; // millis() when the time was set
+
+    bool valuesValid = false;
+    uint32_t lastUpdate;
+    uint16_t temperature;
+    uint8_t brightness;
+
+    void follow(schedule_light_t &entry);
+};
@@ -0,0 +1,485 @@
+#include "esp-knx-led-storage.h"
+
+static const size_t flashSectorSize = 4096;
+
+#if defined(ESP32)
+KnxLedFlashBackend::KnxLedFlashBackend(const char *partitionLabel)
+{
+	partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partitionLabel);
+}
+
+size_t KnxLedFlashBackend::size()
+{
+	return partition != nullptr ? partition->size : 0;
+}
+
+bool KnxLedFlashBackend::read(size_t offset, void *data, size_t length)
+{
+	return partition != nullptr && esp_partition_read(partition, offset, data, length) == ESP_OK;
+}
+
+bool KnxLedFlashBackend::write(size_t offset, const void *data, size_t length)
+{
+	return partition != nullptr && esp_partition_write(partition, offset, data, length) == ESP_OK;
+}
+
+bool KnxLedFlashBackend::erase(size_t offset, size_t length)
+{
+	return partition != nullptr && esp_partition_erase_range(partition, offset, length) == ESP_OK;
+}
+#elif defined(ESP8266)
+KnxLedFlashBackend::KnxLedFlashBackend(uint32_t firstSector, uint8_t sectorCount)
+{
+	this->firstSector = firstSector;
+	this->sectorCount = sectorCount;
+}
+
+size_t KnxLedFlashBackend::size()
+{
+	return sectorCount * flashSectorSize;
+}
+
+// offset and length must be a multiple of 4 bytes
+bool KnxLedFlashBackend::read(size_t offset, void *data, size_t length)
+{
+	return ESP.flashRead(firstSector * flashSectorSize + offset, (uint32_t *)data, length);
+}
+
+// offset and length must be a multiple of 4 bytes
+bool KnxLedFlashBackend::write(size_t offset, const void *data, size_t length)
+{
+	return ESP.flashWrite(firstSector * flashSectorSize + offset, (const uint32_t *)data, length);
+}
+
+bool KnxLedFlashBackend::erase(size_t offset, size_t length)
+{
+	for (size_t sector = offset / flashSectorSize; sector < (offset + length) / flashSectorSize; sector++)
+	{
+		if (!ESP.flashEraseSector(firstSector + sector))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+#endif
+
+#if defined(ESP32) || defined(ESP8266)
+size_t KnxLedFlashBackend::sectorSize()
+{
+	return flashSectorSize;
+}
+#endif
+
+KnxLedSimulatedFlash::KnxLedSimulatedFlash(size_t sectorSize, uint8_t sectorCount)
+{
+	sectorBytes = sectorSize;
+	this->sectorCount = sectorCount;
+	memory = new uint8_t[sectorBytes * sectorCount];
+	eraseCount = new uint32_t[sectorCount]();
+	memset(memory, 0xFF, sectorBytes * sectorCount);
+}
+
+KnxLedSimulatedFlash::~KnxLedSimulatedFlash()
+{
+	delete[] memory;
+	delete[] eraseCount;
+}
+
+size_t KnxLedSimulatedFlash::size()
+{
+	return sectorBytes * sectorCount;
+}
+
+size_t KnxLedSimulatedFlash::sectorSize()
+{
+	return sectorBytes;
+}
+
+bool KnxLedSimulatedFlash::read(size_t offset, void *data, size_t length)
+{
+	if (offset + length > size())
+	{
+		return false;
+	}
+	memcpy(data, memory + offset, length);
+	return true;
+}
+
+bool KnxLedSimulatedFlash::write(size_t offset, const void *data, size_t length)
+{
+	if (offset + length > size())
+	{
+		return false;
+	}
+	// like NOR flash, bits can only be cleared by writing
+	for (size_t i = 0; i < length; i++)
+	{
+		memory[offset + i] &= ((const uint8_t *)data)[i];
+	}
+	return true;
+}
+
+bool KnxLedSimulatedFlash::erase(size_t offset, size_t length)
+{
+	if (offset % sectorBytes != 0 || length % sectorBytes != 0 || offset + length > size())
+	{
+		return false;
+	}
+	memset(memory + offset, 0xFF, length);
+	for (size_t sector = offset / sectorBytes; sector < (offset + length) / sectorBytes; sector++)
+	{
+		eraseCount[sector]++;
+	}
+	return true;
+}
+
+uint32_t KnxLedSimulatedFlash::getEraseCount(uint8_t sector)
+{
+	return sector < sectorCount ? eraseCount[sector] : 0;
+}
+
+uint32_t KnxLedSimulatedFlash::getMaxEraseCount()
+{
+	uint32_t maxCount = 0;
+	for (uint8_t i = 0; i < sectorCount; i++)
+	{
+		maxCount = max(maxCount, eraseCount[i]);
+	}
+	return maxCount;
+}
+
+// lights must be added in the same order on every boot, the position is used as record key
+void KnxLedStorage::addLight(KnxLed *light)
+{
+	if (lightCount < STORAGE_MAX_LIGHTS)
+	{
+		lights[lightCount++] = light;
+	}
+}
+
+void KnxLedStorage::configQuietTime(uint32_t quietTimeMs)
+{
+	quietTime = quietTimeMs;
+}
+
+// restore the persisted values of all added lights. Must be called after all lights were added.
+// Fails if a half can't hold the header and the state and all scenes of every light (520 bytes per light)
+bool KnxLedStorage::begin(KnxLedStorageBackend *storageBackend)
+{
+	backend = storageBackend;
+	halfSize = backend->size() / 2 / backend->sectorSize() * backend->sectorSize();
+	if (halfSize < (1 + lightCount * (1 + SCENE_COUNT)) * sizeof(storage_record_t))
+	{
+		backend = nullptr;
+		return false;
+	}
+
+	uint32_t sequence0 = 0;
+	uint32_t sequence1 = 0;
+	bool valid0 = readHeader(0, sequence0);
+	bool valid1 = readHeader(1, sequence1);
+	if (!valid0 && !valid1)
+	{
+		// empty or unknown flash content
+		activeHalf = 0;
+		sequence = 1;
+		backend->erase(0, halfSize);
+		writeHeader();
+	}
+	else
+	{
+		activeHalf = valid1 && (!valid0 || (int32_t)(sequence1 - sequence0) > 0) ? 1 : 0;
+		sequence = activeHalf ? sequence1 : sequence0;
+	}
+
+	// replay the log, later records override earlier ones
+	size_t base = activeHalf * halfSize;
+	writeOffset = base + halfSize;
+	for (size_t offset = sizeof(storage_record_t); offset < halfSize; offset += sizeof(buffer))
+	{
+		size_t length = min(sizeof(buffer), halfSize - offset);
+		if (!backend->read(base + offset, buffer, length))
+		{
+			break;
+		}
+		bool endOfLog = false;
+		for (size_t i = 0; i < length / sizeof(storage_record_t); i++)
+		{
+			if (buffer[i].light == STORAGE_LIGHT_FREE)
+			{
+				writeOffset = base + offset + i * sizeof(storage_record_t);
+				endOfLog = true;
+				break;
+			}
+			// records with a wrong CRC were interrupted while writing and are skipped
+			if (buffer[i].crc == crc8(buffer[i]))
+			{
+				restoreRecord(buffer[i]);
+			}
+		}
+		if (endOfLog)
+		{
+			break;
+		}
+	}
+	bufferCount = 0;
+
+	for (uint8_t i = 0; i < lightCount; i++)
+	{
+		readState(i, persistedState[i]);
+		memcpy(lastState[i], persistedState[i], 5);
+		lights[i]->clearChangedScenes();
+	}
+	lastChange = millis();
+	return true;
+}
+
+void KnxLedStorage::loop()
+{
+	if (backend == nullptr || millis() - lastPoll < STORAGE_POLL_INTERVAL)
+	{
+		return;
+	}
+	lastPoll = millis();
+
+	// every change restarts the quiet time, so values are only written once they are settled
+	for (uint8_t i = 0; i < lightCount; i++)
+	{
+		uint8_t state[5];
+		readState(i, state);
+		if (memcmp(state, lastState[i], 5) != 0)
+		{
+			memcpy(lastState[i], state, 5);
+			lastChange = millis();
+		}
+	}
+
+	if (millis() - lastChange >= quietTime && hasChanges())
+	{
+		writeChanges();
+	}
+}
+
+// write all pending changes immediately, e.g. before a planned restart
+void KnxLedStorage::flush()
+{
+	if (backend != nullptr)
+	{
+		for (uint8_t i = 0; i < lightCount; i++)
+		{
+			readState(i, lastState[i]);
+		}
+		if (hasChanges())
+		{
+			writeChanges();
+		}
+	}
+}
+
+// number of batched writes since boot
+uint32_t KnxLedStorage::getWriteCount()
+{
+	return writeCount;
+}
+
+bool KnxLedStorage::hasChanges()
+{
+	for (uint8_t i = 0; i < lightCount; i++)
+	{
+		if (lights[i]->getChangedScenes() != 0 || memcmp(lastState[i], persistedState[i], 5) != 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// append all changed values as one batch. If the active half is full, the latest values are compacted into the other half
+void KnxLedStorage::writeChanges()
+{
+	size_t records = 0;
+	for (uint8_t i = 0; i < lightCount; i++)
+	{
+		if (memcmp(lastState[i], persistedState[i], 5) != 0)
+		{
+			records++;
+		}
+		for (uint64_t changed = lights[i]->getChangedScenes(); changed != 0; changed &= changed - 1)
+		{
+			records++;
+		}
+	}
+
+	writeCount++;
+	if (writeOffset + records * sizeof(storage_record_t) > (activeHalf + 1) * halfSize)
+	{
+		compact();
+		return;
+	}
+
+	for (uint8_t i = 0; i < lightCount; i++)
+	{
+		if (memcmp(lastState[i], persistedState[i], 5) != 0)
+		{
+			appendRecord(i, STORAGE_KEY_STATE, lastState[i]);
+			memcpy(persistedState[i], lastState[i], 5);
+		}
+		uint64_t changed = lights[i]->getChangedScenes();
+		for (uint8_t scene = 0; scene < SCENE_COUNT; scene++)
+		{
+			if (changed & (1ULL << scene))
+			{
+				appendRecord(i, scene, (const uint8_t *)&lights[i]->scenes->scene[scene]);
+			}
+		}
+		lights[i]->clearChangedScenes();
+	}
+	flushBuffer();
+}
+
+// write the latest values of all lights into the other half. The header is written last, so an interrupted
+// compaction leaves the old half active
+bool KnxLedStorage::compact()
+{
+	size_t oldWriteOffset = writeOffset;
+	activeHalf ^= 1;
+	sequence++;
+	backend->erase(activeHalf * halfSize, halfSize);
+	writeOffset = activeHalf * halfSize + sizeof(storage_record_t);
+	bufferCount = 0;
+
+	bool complete = true;
+	for (uint8_t i = 0; i < lightCount && complete; i++)
+	{
+		complete = appendRecord(i, STORAGE_KEY_STATE, lastState[i]);
+		for (uint8_t scene = 0; scene < SCENE_COUNT && complete; scene++)
+		{
+			scene_t data;
+			if (lights[i]->getSceneData(scene, data))
+			{
+				complete = appendRecord(i, scene, (const uint8_t *)&data);
+			}
+		}
+	}
+	if (!complete)
+	{
+		// not reachable with the size check of begin(). The old half stays active with the changes still pending,
+		// storage is stopped so the other half isn't erased again on every change
+		activeHalf ^= 1;
+		sequence--;
+		writeOffset = oldWriteOffset;
+		bufferCount = 0;
+		backend = nullptr;
+		return false;
+	}
+	flushBuffer();
+	writeHeader();
+	for (uint8_t i = 0; i < lightCount; i++)
+	{
+		memcpy(persistedState[i], lastState[i], 5);
+		lights[i]->clearChangedScenes();
+	}
+	return true;
+}
+
+void KnxLedStorage::restoreRecord(const storage_record_t &record)
+{
+	if (record.light >= lightCount)
+	{
+		return;
+	}
+	KnxLed *light = lights[record.light];
+	if (record.key == STORAGE_KEY_STATE)
+	{
+		light->savedBrightness = record.data[0];
+		light->savedHsv.h = record.data[1];
+		light->savedHsv.s = record.data[2];
+		light->savedHsv.v = record.data[3];
+		// the snapshot of a warm restart is newer than the flash
+		if (!light->warmRestored)
+		{
+			light->setpointTemperature = 2700 + record.data[4] * 20;
+			if (light->setpointBrightness == 0)
+			{
+				light->actTemperature = light->setpointTemperature;
+			}
+		}
+	}
+	else if (record.key < SCENE_COUNT)
+	{
+		scene_t scene;
+		memcpy(&scene, record.data, sizeof(scene_t));
+		light->setSceneData(record.key, scene);
+	}
+}
+
+void KnxLedStorage::readState(uint8_t light, uint8_t state[5])
+{
+	state[0] = lights[light]->savedBrightness;
+	state[1] = lights[light]->savedHsv.h;
+	state[2] = lights[light]->savedHsv.s;
+	state[3] = lights[light]->savedHsv.v;
+	state[4] = (lights[light]->setpointTemperature - 2700) / 20;
+}
+
+bool KnxLedStorage::appendRecord(uint8_t light, uint8_t key, const uint8_t *data)
+{
+	if (writeOffset + (bufferCount + 1) * sizeof(storage_record_t) > (activeHalf + 1) * halfSize)
+	{
+		return false;
+	}
+	storage_record_t &record = buffer[bufferCount++];
+	record.light = light;
+	record.key = key;
+	memset(record.data, 0xFF, sizeof(record.data));
+	memcpy(record.data, data, key == STORAGE_KEY_STATE ? 5 : sizeof(scene_t));
+	record.crc = crc8(record);
+	if (bufferCount == STORAGE_WRITE_BUFFER)
+	{
+		flushBuffer();
+	}
+	return true;
+}
+
+void KnxLedStorage::flushBuffer()
+{
+	if (bufferCount > 0)
+	{
+		backend->write(writeOffset, buffer, bufferCount * sizeof(storage_record_t));
+		writeOffset += bufferCount * sizeof(storage_record_t);
+		bufferCount = 0;
+	}
+}
+
+bool KnxLedStorage::readHeader(uint8_t half, uint32_t &headerSequence)
+{
+	storage_record_t header __attribute__((aligned(4)));
+	if (!backend->read(half * halfSize, &header, sizeof(header)))
+	{
+		return false;
+	}
+	if (header.light != STORAGE_LIGHT_HEADER || header.key != STORAGE_VERSION || header.crc != crc8(header))
+	{
+		return false;
+	}
+	memcpy(&headerSequence, header.data, sizeof(headerSequence));
+	return true;
+}
+
+void KnxLedStorage::writeHeader()
+{
+	storage_record_t header __attribute__((aligned(4)));
+	header.light = STORAGE_LIGHT_HEADER;
+	header.key = STORAGE_VERSION;
+	memcpy(header.data, &sequence, sizeof(sequence));
+	header.data[4] = 0xFF;
+	header.crc = crc8(header);
+	backend->write(activeHalf * halfSize, &header, sizeof(header));
+}
+
+// CRC-8 over the record without the CRC byte
+uint8_t KnxLedStorage::crc8(const storage_record_t &record)
+{
+	return knxLedCrc8((const uint8_t *)&record, sizeof(storage_record_t) - 1);
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "esp-knx-led.h"
+#if defined(ESP32)
+#include "esp_partition.h"
+#endif
+
+#define STORAGE_MAX_LIGHTS 16
+#define STORAGE_QUIET_TIME 10000   // ms without any change before the values are written
+#define STORAGE_POLL_INTERVAL 100  // ms
+#define STORAGE_WRITE_BUFFER 16    // records which are written to flash at once
+#define STORAGE_LIGHT_HEADER 0xFE  // storage_record_t.light of the header record
+#define STORAGE_LIGHT_FREE 0xFF    // storage_record_t.light of an erased record
+#define STORAGE_KEY_STATE 0xFF     // storage_record_t.key of a light state record, otherwise scene number
+#define STORAGE_VERSION 1
+
+typedef struct __storageRecord
+{
+    uint8_t light;   // index of the light, STORAGE_LIGHT_HEADER or STORAGE_LIGHT_FREE
+    uint8_t key;     // STORAGE_KEY_STATE or scene number
+    uint8_t data[5];
+    uint8_t crc;
+} storage_record_t;
+
+// Flash area used by KnxLedStorage. The area is split into two halves which are used alternately
+class KnxLedStorageBackend
+{
+public:
+    virtual ~KnxLedStorageBackend() {}
+    virtual size_t size() = 0;
+    virtual size_t sectorSize() = 0;
+    virtual bool read(size_t offset, void *data, size_t length) = 0;
+    virtual bool write(size_t offset, const void *data, size_t length) = 0;
+    virtual bool erase(size_t offset, size_t length) = 0;
+};
+
+#if defined(ESP32) || defined(ESP8266)
+class KnxLedFlashBackend : public KnxLedStorageBackend
+{
+public:
+#if defined(ESP32)
+    KnxLedFlashBackend(const char *partitionLabel); // data partition, e.g. "knxled"
+#else
+    KnxLedFlashBackend(uint32_t firstSector, uint8_t sectorCount); // unused flash sectors, e.g. below the EEPROM sector
+#endif
+
+    size_t size();
+    size_t sectorSize();
+    bool read(size_t offset, void *data, size_t length);
+    bool write(size_t offset, const void *data, size_t length);
+    bool erase(size_t offset, size_t length);
+
+private:
+#if defined(ESP32)
+    const esp_partition_t *partition;
+#else
+    uint32_t firstSector;
+    uint8_t sectorCount;
+#endif
+};
+#endif
+
+// RAM with the behaviour of NOR flash (writing can only clear bits) which counts the erase cycles per sector
+class KnxLedSimulatedFlash : public KnxLedStorageBackend
+{
+public:
+    KnxLedSimulatedFlash(size_t sectorSize, uint8_t sectorCount);
+    ~KnxLedSimulatedFlash();
+    KnxLedSimulatedFlash(const KnxLedSimulatedFlash &) = delete; // owns the memory
+    KnxLedSimulatedFlash &operator=(const KnxLedSimulatedFlash &) = delete;
+
+    size_t size();
+    size_t sectorSize();
+    bool read(size_t offset, void *data, size_t length);
+    bool write(size_t offset, const void *data, size_t length);
+    bool erase(size_t offset, size_t length);
+
+    uint32_t getEraseCount(uint8_t sector);
+    uint32_t getMaxEraseCount();
+
+private:
+    size_t sectorBytes;
+    uint8_t sectorCount;
+    uint8_t *memory;
+    uint32_t *eraseCount;
+};
+
+// Wear levelled persistence of the saved brightness, color, color temperature and scenes of all lights.
+// Changes are collected until no value was changed for the quiet time and then appended to a log in flash.
+// The color temperature is the last one (setpoint), which is used when the light is switched on with a default
+// temperature of 0. The default temperature itself is configured by the application on every boot.
+class KnxLedStorage
+{
+public:
+    void addLight(KnxLed *light);
+    bool begin(KnxLedStorageBackend *storageBackend);
+    void configQuietTime(uint32_t quietTimeMs);
+
+    void loop();
+    void flush();
+
+    uint32_t getWriteCount();
+
+private:
+    KnxLedStorageBackend *backend = nullptr;
+    KnxLed *lights[STORAGE_MAX_LIGHTS];
+    uint8_t lightCount = 0;
+
+    uint8_t persistedState[STORAGE_MAX_LIGHTS][5];
+    uint8_t lastState[STORAGE_MAX_LIGHTS][5];
+    unsigned long lastChange = 0;
+    unsigned long lastPoll = 0;
+    uint32_t quietTime = STORAGE_QUIET_TIME;
+    uint32_t writeCount = 0;
+
+    size_t halfSize = 0;
+    uint8_t activeHalf = 0;
+    uint32_t sequence = 0;
+    size_t writeOffset = 0;
+    storage_record_t buffer[STORAGE_WRITE_BUFFER] __attribute__((aligned(4)));
+    uint8_t bufferCount = 0;
+
+    bool hasChanges();
+    void writeChanges();
+    bool compact();
+    void restoreRecord(const storage_record_t &record);
+    void readState(uint8_t light, uint8_t state[5]);
+    bool appendRecord(uint8_t light, uint8_t key, const uint8_t *data);
+    void flushBuffer();
+    bool readHeader(uint8_t half, uint32_t &headerSequence);
+    void writeHeader();
+    uint8_t crc8(const storage_record_t &record);
+};
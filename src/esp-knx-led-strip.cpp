@@ -0,0 +1,229 @@
+#include "esp-knx-led-strip.h"
+
+#if defined(ESP32)
+// RMT clock of 40 MHz (80 MHz APB / 2), 25 ns per tick
+#define RMT_CLOCK_DIVIDER 2
+static const rmt_item32_t rmtBit0 = {{{16, 1, 34, 0}}}; // 0.4 us high, 0.85 us low
+static const rmt_item32_t rmtBit1 = {{{32, 1, 18, 0}}}; // 0.8 us high, 0.45 us low
+
+// called by the RMT driver for each part of the frame which fits into the RMT memory
+static void IRAM_ATTR rmtTranslator(const void *src, rmt_item32_t *dest, size_t srcSize, size_t wantedNum, size_t *translatedSize, size_t *itemNum)
+{
+	const uint8_t *data = (const uint8_t *)src;
+	size_t size = 0;
+	size_t num = 0;
+	while (size < srcSize && num + 8 <= wantedNum)
+	{
+		for (uint8_t mask = 0x80; mask != 0; mask >>= 1)
+		{
+			dest[num++] = data[size] & mask ? rmtBit1 : rmtBit0;
+		}
+		size++;
+	}
+	*translatedSize = size;
+	*itemNum = num;
+}
+
+KnxLedStripRmt::KnxLedStripRmt(uint8_t pin, rmt_channel_t channel)
+{
+	this->pin = pin;
+	this->channel = channel;
+}
+
+bool KnxLedStripRmt::begin(size_t length)
+{
+	(void)length; // the translator reads the frame buffer, no memory depends on the length
+	rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)pin, channel);
+	config.clk_div = RMT_CLOCK_DIVIDER;
+	return rmt_config(&config) == ESP_OK && rmt_driver_install(channel, 0, 0) == ESP_OK && rmt_translator_init(channel, rmtTranslator) == ESP_OK;
+}
+
+bool KnxLedStripRmt::busy()
+{
+	return rmt_wait_tx_done(channel, 0) != ESP_OK;
+}
+
+void KnxLedStripRmt::show(const uint8_t *pixels, size_t length)
+{
+	rmt_write_sample(channel, pixels, length, false);
+}
+#elif defined(ESP8266)
+KnxLedStripBitbang::KnxLedStripBitbang(uint8_t pin)
+{
+	this->pin = pin;
+}
+
+bool KnxLedStripBitbang::begin(size_t length)
+{
+	if (pin > 15 || length > STRIP_BITBANG_MAX_BYTES)
+	{
+		return false;
+	}
+	pinMode(pin, OUTPUT);
+	digitalWrite(pin, LOW);
+	return true;
+}
+
+bool KnxLedStripBitbang::busy()
+{
+	return false;
+}
+
+void IRAM_ATTR KnxLedStripBitbang::show(const uint8_t *pixels, size_t length)
+{
+	const uint32_t t0h = F_CPU / 2500000; // 0.4 us
+	const uint32_t t1h = F_CPU / 1250000; // 0.8 us
+	const uint32_t period = F_CPU / 800000; // 1.25 us
+	const uint32_t pinMask = 1 << pin;
+
+	noInterrupts();
+	uint32_t start = ESP.getCycleCount() - period;
+	for (size_t i = 0; i < length; i++)
+	{
+		for (uint8_t mask = 0x80; mask != 0; mask >>= 1)
+		{
+			uint32_t high = pixels[i] & mask ? t1h : t0h;
+			while (ESP.getCycleCount() - start < period)
+			{
+			}
+			start = ESP.getCycleCount();
+			GPOS = pinMask;
+			while (ESP.getCycleCount() - start < high)
+			{
+			}
+			GPOC = pinMask;
+		}
+	}
+	interrupts();
+}
+#endif
+
+KnxLedStripCapture::~KnxLedStripCapture()
+{
+	delete[] frame;
+}
+
+bool KnxLedStripCapture::begin(size_t length)
+{
+	delete[] frame;
+	frame = new uint8_t[length]();
+	this->length = length;
+	return true;
+}
+
+bool KnxLedStripCapture::busy()
+{
+	return false;
+}
+
+void KnxLedStripCapture::show(const uint8_t *pixels, size_t length)
+{
+	memcpy(frame, pixels, min(length, this->length));
+	frameCount++;
+}
+
+const uint8_t *KnxLedStripCapture::getFrame()
+{
+	return frame;
+}
+
+uint32_t KnxLedStripCapture::getFrameCount()
+{
+	return frameCount;
+}
+
+// 10 bit duty to 8 bit pixel value
+void KnxLedStripSegment::write(uint8_t channel, uint16_t duty)
+{
+	strip->write(*this, channel, duty >> 2);
+}
+
+KnxLedStrip::KnxLedStrip(uint16_t pixelCount, __stripType type)
+{
+	this->pixelCount = pixelCount;
+	bytesPerPixel = type == STRIP_SK6812_RGBW ? 4 : 3;
+	pixels = new uint8_t[pixelCount * bytesPerPixel]();
+}
+
+KnxLedStrip::~KnxLedStrip()
+{
+	delete[] pixels;
+}
+
+bool KnxLedStrip::begin(KnxLedStripOutput *stripOutput)
+{
+	if (!stripOutput->begin(pixelCount * bytesPerPixel))
+	{
+		return false;
+	}
+	output = stripOutput;
+	changed = true;
+	return true;
+}
+
+void KnxLedStrip::loop()
+{
+	if (!changed || output == nullptr || millis() - lastShow < STRIP_FRAME_INTERVAL || output->busy())
+	{
+		return;
+	}
+	lastShow = millis();
+	changed = false;
+	frameCount++;
+	output->show(pixels, pixelCount * bytesPerPixel);
+}
+
+uint8_t *KnxLedStrip::getPixels()
+{
+	return pixels;
+}
+
+uint16_t KnxLedStrip::getPixelCount()
+{
+	return pixelCount;
+}
+
+uint8_t KnxLedStrip::getBytesPerPixel()
+{
+	return bytesPerPixel;
+}
+
+uint32_t KnxLedStrip::getFrameCount()
+{
+	return frameCount;
+}
+
+KnxLedStripSegment *KnxLedStrip::addSegment(uint16_t first, uint16_t count)
+{
+	if (segmentCount >= STRIP_MAX_SEGMENTS || count == 0 || first + count > pixelCount)
+	{
+		return nullptr;
+	}
+	KnxLedStripSegment *segment = &segments[segmentCount++];
+	segment->strip = this;
+	segment->first = first;
+	segment->count = count;
+	return segment;
+}
+
+// byte of a KnxLed channel (red, green, blue, white) within a GRB(W) pixel
+uint8_t KnxLedStrip::channelOffset(uint8_t channel)
+{
+	static const uint8_t offsets[4] = {1, 0, 2, 3};
+	return offsets[channel];
+}
+
+// all pixels of a segment have the same color, so the first pixel tells whether the value changed
+void KnxLedStrip::write(const KnxLedStripSegment &segment, uint8_t offset, uint8_t value)
+{
+	uint8_t *pixel = pixels + segment.first * bytesPerPixel + offset;
+	if (*pixel == value)
+	{
+		return;
+	}
+	for (uint16_t i = 0; i < segment.count; i++, pixel += bytesPerPixel)
+	{
+		*pixel = value;
+	}
+	changed = true;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "esp-knx-led.h"
+#include "esp-knx-led-output.h"
+#if defined(ESP32)
+#include "driver/rmt.h"
+#endif
+
+#define STRIP_MAX_SEGMENTS 8
+#define STRIP_FRAME_INTERVAL 16 // ms, ~60 fps
+#define STRIP_BITBANG_MAX_BYTES 300 // ESP8266: frame bytes sent with disabled interrupts, 10 us each (3 ms, 100 RGB pixels)
+
+enum __stripType
+{
+    STRIP_WS2812,     // GRB, 3 bytes per pixel
+    STRIP_SK6812_RGBW // GRBW, 4 bytes per pixel
+};
+
+// part of a strip which is controlled by one KnxLed, the output channels are the bytes of a pixel
+class KnxLedStripSegment : public KnxLedOutput
+{
+    friend class KnxLedStrip;
+
+public:
+    void write(uint8_t channel, uint16_t duty);
+
+private:
+    KnxLedStrip *strip;
+    uint16_t first;
+    uint16_t count;
+};
+
+// Sends the frame buffer to the pixels. show() must not modify the buffer.
+class KnxLedStripOutput
+{
+public:
+    virtual ~KnxLedStripOutput() {}
+    virtual bool begin(size_t length) = 0;
+    virtual bool busy() = 0; // true while the previous frame is sent
+    virtual void show(const uint8_t *pixels, size_t length) = 0;
+};
+
+#if defined(ESP32)
+// RMT with a translator which encodes the frame buffer while it is sent, so there is no encoded copy of the frame.
+// Changes of the buffer during a transmission appear in the next frame at the latest.
+class KnxLedStripRmt : public KnxLedStripOutput
+{
+public:
+    KnxLedStripRmt(uint8_t pin, rmt_channel_t channel = RMT_CHANNEL_0);
+
+    bool begin(size_t length);
+    bool busy();
+    void show(const uint8_t *pixels, size_t length);
+
+private:
+    uint8_t pin;
+    rmt_channel_t channel;
+};
+#elif defined(ESP8266)
+// Cycle counted bitbanging on GPIO 0..15. Blocks with disabled interrupts while sending, ~30 us per RGB pixel.
+// Longer frames would stall WiFi and the timers, begin() fails above STRIP_BITBANG_MAX_BYTES (100 RGB or 75 RGBW pixels)
+class KnxLedStripBitbang : public KnxLedStripOutput
+{
+public:
+    KnxLedStripBitbang(uint8_t pin);
+
+    bool begin(size_t length);
+    bool busy();
+    void show(const uint8_t *pixels, size_t length);
+
+private:
+    uint8_t pin;
+};
+#endif
+
+// RAM copy of the last frame, e.g. to check the rendered pixels without hardware
+class KnxLedStripCapture : public KnxLedStripOutput
+{
+public:
+    KnxLedStripCapture() {}
+    ~KnxLedStripCapture();
+    KnxLedStripCapture(const KnxLedStripCapture &) = delete; // owns the frame
+    KnxLedStripCapture &operator=(const KnxLedStripCapture &) = delete;
+
+    bool begin(size_t length);
+    bool busy();
+    void show(const uint8_t *pixels, size_t length);
+
+    const uint8_t *getFrame();
+    uint32_t getFrameCount();
+
+private:
+    uint8_t *frame = nullptr;
+    size_t length = 0;
+    uint32_t frameCount = 0;
+};
+
+// Frame buffer of a WS2812/SK6812 strip. Each segment is a KnxLed (see KnxLed::initStripLight) with the usual
+// HSV/CCT handling, its channel values are written to all pixels of the segment instead of a PWM output.
+class KnxLedStrip
+{
+    friend class KnxLed;
+    friend class KnxLedStripSegment;
+
+public:
+    KnxLedStrip(uint16_t pixelCount, __stripType type = STRIP_WS2812);
+    ~KnxLedStrip();
+    KnxLedStrip(const KnxLedStrip &) = delete; // owns the pixels, the segments point to the strip
+    KnxLedStrip &operator=(const KnxLedStrip &) = delete;
+
+    bool begin(KnxLedStripOutput *stripOutput);
+    void loop(); // sends the frame if a pixel was changed, at most every STRIP_FRAME_INTERVAL
+
+    uint8_t *getPixels();
+    uint16_t getPixelCount();
+    uint8_t getBytesPerPixel();
+    uint32_t getFrameCount();
+
+private:
+    KnxLedStripOutput *output = nullptr;
+    uint8_t *pixels;
+    uint16_t pixelCount;
+    uint8_t bytesPerPixel;
+    bool changed = false;
+    unsigned long lastShow = 0;
+    uint32_t frameCount = 0;
+
+    KnxLedStripSegment segments[STRIP_MAX_SEGMENTS];
+    uint8_t segmentCount = 0;
+
+    KnxLedStripSegment *addSegment(uint16_t first, uint16_t count);
+    uint8_t channelOffset(uint8_t channel);
+    void write(const KnxLedStripSegment &segment, uint8_t offset, uint8_t value);
+};
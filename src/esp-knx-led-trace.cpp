@@ -0,0 +1,187 @@
+#include "esp-knx-led-trace.h"
+
+// simulated time of a replay, the trace has no timestamps
+static uint32_t replayTime = 0;
+
+static uint32_t replayClock()
+{
+	return replayTime;
+}
+
+KnxLedTrace::KnxLedTrace(uint16_t size, bool recordDuties)
+{
+	this->recordDuties = recordDuties;
+	this->size = max<uint16_t>(size, 1);
+	entries = new trace_entry_t[this->size];
+}
+
+KnxLedTrace::~KnxLedTrace()
+{
+	delete[] entries;
+}
+
+void KnxLedTrace::clear()
+{
+	head = 0;
+	count = 0;
+}
+
+uint16_t KnxLedTrace::getCount()
+{
+	return count;
+}
+
+// index 0 is the oldest entry
+trace_entry_t KnxLedTrace::getEntry(uint16_t index)
+{
+	return entries[(head + size - count + index) % size];
+}
+
+void KnxLedTrace::record(uint8_t type, uint8_t d0, uint8_t d1, uint8_t d2)
+{
+	trace_entry_t entry;
+	entry.tick = ticks;
+	entry.type = type;
+	entry.data[0] = d0;
+	entry.data[1] = d1;
+	entry.data[2] = d2;
+	append(entry);
+}
+
+void KnxLedTrace::append(const trace_entry_t &entry)
+{
+	entries[head] = entry;
+	head = (head + 1) % size;
+	if (count < size)
+	{
+		count++;
+	}
+}
+
+// one line per entry: tick,type,d0,d1,d2
+void KnxLedTrace::dump(Print &output)
+{
+	for (uint16_t i = 0; i < count; i++)
+	{
+		trace_entry_t entry = getEntry(i);
+		output.printf("%u,%u,%u,%u,%u\n", entry.tick, entry.type, entry.data[0], entry.data[1], entry.data[2]);
+	}
+}
+
+// append one line of a dump, e.g. received via serial from a customer device
+bool KnxLedTrace::parse(const char *line)
+{
+	unsigned int tick, type, d0, d1, d2;
+	if (sscanf(line, "%u,%u,%u,%u,%u", &tick, &type, &d0, &d1, &d2) != 5 || type > TRACE_DUTY)
+	{
+		return false;
+	}
+	trace_entry_t entry;
+	entry.tick = tick;
+	entry.type = type;
+	entry.data[0] = d0;
+	entry.data[1] = d1;
+	entry.data[2] = d2;
+	append(entry);
+	return true;
+}
+
+// Feed the recorded commands into a freshly initialized light with the same configuration, tick by tick.
+// The channel duties of every tick are written as CSV: tick,ch0,ch1,ch2,ch3,ch4
+// The shared clock of all lights runs on simulated time during the replay, starting at 0 and advancing by
+// tickInterval per tick, and is restored afterwards.
+void KnxLedTrace::replay(KnxLed &light, Print &csv, uint32_t extraTicks, uint16_t tickInterval)
+{
+	if (count == 0)
+	{
+		return;
+	}
+	KnxLedTrace *lightTrace = light.trace;
+	light.trace = nullptr;
+	clockSource *clockFctn = KnxLed::clockFctn;
+	uint32_t clockOffset = KnxLed::clockOffset;
+	replayTime = 0;
+	KnxLed::clockFctn = replayClock;
+	KnxLed::clockOffset = 0;
+
+	csv.println("tick,ch0,ch1,ch2,ch3,ch4");
+	uint32_t t = getEntry(0).tick;
+	for (uint16_t i = 0; i < count; i++)
+	{
+		trace_entry_t entry = getEntry(i);
+		if (entry.type == TRACE_DUTY)
+		{
+			continue;
+		}
+		while (t < entry.tick)
+		{
+			tick(light, csv, ++t, tickInterval);
+		}
+		apply(light, entry);
+	}
+	for (uint32_t i = 0; i < extraTicks; i++)
+	{
+		tick(light, csv, ++t, tickInterval);
+	}
+
+	KnxLed::clockFctn = clockFctn;
+	KnxLed::clockOffset = clockOffset;
+	light.trace = lightTrace;
+}
+
+void KnxLedTrace::tick(KnxLed &light, Print &csv, uint32_t tick, uint16_t tickInterval)
+{
+	replayTime += tickInterval;
+	light.loop();
+	writeDuties(light, csv, tick);
+}
+
+void KnxLedTrace::apply(KnxLed &light, const trace_entry_t &entry)
+{
+	dpt3_t dpt3;
+	dpt3.fromDPT3(entry.data[0]);
+	switch (entry.type)
+	{
+	case TRACE_SWITCH:
+		light.switchLight(entry.data[0]);
+		break;
+	case TRACE_BRIGHTNESS:
+		light.setBrightness(entry.data[0], entry.data[1]);
+		break;
+	case TRACE_TEMPERATURE:
+		light.setTemperature(entry.data[0] | (entry.data[1] << 8));
+		break;
+	case TRACE_RGB:
+		light.setRgb({entry.data[0], entry.data[1], entry.data[2]});
+		break;
+	case TRACE_HSV:
+		light.setHsv({entry.data[0], entry.data[1], entry.data[2]});
+		break;
+	case TRACE_REL_DIMM:
+		light.setRelDimmCmd(dpt3);
+		break;
+	case TRACE_REL_TEMPERATURE:
+		light.setRelTemperatureCmd(dpt3);
+		break;
+	case TRACE_REL_HUE:
+		light.setRelHueCmd(dpt3);
+		break;
+	case TRACE_REL_SATURATION:
+		light.setRelSaturationCmd(dpt3);
+		break;
+	case TRACE_EFFECT:
+		light.setEffect(entry.data[0]);
+		break;
+	case TRACE_RECALL_SCENE:
+		light.recallScene(entry.data[0]);
+		break;
+	case TRACE_LEARN_SCENE:
+		light.learnScene(entry.data[0]);
+		break;
+	}
+}
+
+void KnxLedTrace::writeDuties(KnxLed &light, Print &csv, uint32_t tick)
+{
+	csv.printf("%u,%u,%u,%u,%u,%u\n", tick, light.getChannelDuty(0), light.getChannelDuty(1), light.getChannelDuty(2), light.getChannelDuty(3), light.getChannelDuty(4));
+}
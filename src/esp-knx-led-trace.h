@@ -0,0 +1,66 @@
+#pragma once
+
+#include "esp-knx-led.h"
+
+#define TRACE_DEFAULT_SIZE 256 // entries, 8 bytes each
+#define TRACE_TICK_INTERVAL 10 // ms of simulated time per replayed tick
+
+enum __traceType
+{
+    TRACE_SWITCH,          // d0 = state
+    TRACE_BRIGHTNESS,      // d0 = brightness, d1 = saveValue
+    TRACE_TEMPERATURE,     // d0/d1 = temperature (little endian)
+    TRACE_RGB,             // d0/d1/d2 = red/green/blue
+    TRACE_HSV,             // d0/d1/d2 = hue/saturation/value
+    TRACE_REL_DIMM,        // d0 = DPT 3
+    TRACE_REL_TEMPERATURE, // d0 = DPT 3
+    TRACE_REL_HUE,         // d0 = DPT 3
+    TRACE_REL_SATURATION,  // d0 = DPT 3
+    TRACE_EFFECT,          // d0 = effect number
+    TRACE_RECALL_SCENE,    // d0 = scene number
+    TRACE_LEARN_SCENE,     // d0 = scene number
+    TRACE_DUTY             // d0 = channel, d1/d2 = duty (little endian)
+};
+
+typedef struct __traceEntry
+{
+    uint32_t tick;   // loop() count of the light
+    uint8_t type;    // __traceType
+    uint8_t data[3];
+} trace_entry_t;
+
+// Ring buffer of the commands and output duties of one light. Recording costs one entry copy per command or changed duty.
+// The dump can be replayed in a light with the same configuration, which writes the duties of every tick as CSV.
+// The replay runs on a simulated clock, so effects and synced transitions give the same duties on every run.
+class KnxLedTrace
+{
+    friend class KnxLed;
+
+public:
+    KnxLedTrace(uint16_t size = TRACE_DEFAULT_SIZE, bool recordDuties = true);
+    ~KnxLedTrace();
+    KnxLedTrace(const KnxLedTrace &) = delete; // owns the entries
+    KnxLedTrace &operator=(const KnxLedTrace &) = delete;
+
+    void clear();
+    uint16_t getCount();
+    trace_entry_t getEntry(uint16_t index);
+
+    void dump(Print &output);
+    bool parse(const char *line);
+    void replay(KnxLed &light, Print &csv, uint32_t extraTicks = 1000, uint16_t tickInterval = TRACE_TICK_INTERVAL);
+
+private:
+    trace_entry_t *entries;
+    uint16_t size;
+    uint16_t head = 0;  // next entry to write
+    uint16_t count = 0;
+    uint32_t ticks = 0;
+    bool recordDuties;  // duties need up to 5 entries per tick, without them the buffer covers a longer command history
+
+    void record(uint8_t type, uint8_t d0, uint8_t d1 = 0, uint8_t d2 = 0);
+    void append(const trace_entry_t &entry);
+    void tick(KnxLed &light, Print &csv, uint32_t tick, uint16_t tickInterval);
+    void apply(KnxLed &light, const trace_entry_t &entry);
+    void writeDuties(KnxLed &light, Print &csv, uint32_t tick);
+};
@@ -1,10 +1,142 @@
 #include "esp-knx-led.h"
+#include "esp-knx-led-trace.h"
+#include "esp-knx-led-output.h"
+#include "esp-knx-led-strip.h"
+#include "esp-knx-led-batch.h"
 #if defined(ESP32)
 byte nextEsp32LedChannel = LEDC_CHANNEL_0; // next available LED channel for ESP32
+// LEDC channels 0-7 belong to the first speed group, 8-15 to the second one (same mapping as ledcWrite)
+#define ESP32_LEDC_MODE(ch) ((ledc_mode_t)((ch) / 8))
+#define ESP32_LEDC_CHANNEL(ch) ((ledc_channel_t)((ch) % 8))
 #endif
 
+#if defined(ESP32)
+// RTC slow memory is not initialized after a software or watchdog reset
+RTC_NOINIT_ATTR static snapshot_t rtcSnapshots[SNAPSHOT_SLOTS];
+#elif defined(ESP8266)
+#include <user_interface.h> // reset reasons
+#endif
+static uint8_t nextSnapshotSlot = 0;
+
+const uint16_t lookupTable[256] PROGMEM = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 24, 25, 26, 27, 28, 29, 30, 31, 32, 34, 35, 36, 37, 38, 39, 41, 42, 43, 44, 45,
+	47, 48, 49, 51, 52, 53, 54, 56, 57, 59, 60, 61, 63, 64, 66, 67, 69, 70, 72, 73, 75, 76, 78, 79, 81, 83, 84, 86, 88, 89, 91, 93, 95, 96, 98, 100, 102, 104, 106,
+	108, 109, 111, 113, 115, 117, 120, 122, 124, 126, 128, 130, 132, 135, 137, 139, 142, 144, 146, 149, 151, 154, 156, 159, 161, 164, 166, 169, 172, 174, 177, 180,
+	183, 185, 188, 191, 194, 197, 200, 203, 206, 209, 212, 215, 219, 222, 225, 228, 232, 235, 238, 242, 245, 249, 252, 256, 260, 263, 267, 271, 275, 278, 282, 286,
+	290, 294, 298, 302, 306, 310, 315, 319, 323, 327, 332, 336, 341, 345, 350, 354, 359, 364, 368, 373, 378, 383, 388, 392, 397, 403, 408, 413, 418, 423, 428, 434,
+	439, 445, 450, 456, 461, 467, 472, 478, 484, 490, 496, 502, 508, 514, 520, 526, 532, 538, 545, 551, 557, 564, 570, 577, 584, 590, 597, 604, 611, 618, 625, 632,
+	639, 646, 653, 660, 668, 675, 683, 690, 698, 705, 713, 721, 729, 736, 744, 752, 760, 769, 777, 785, 793, 802, 810, 819, 827, 836, 845, 853, 862, 871, 880, 889,
+	898, 907, 917, 926, 935, 945, 954, 964, 973, 983, 993, 1003, 1013, 1023};
+
+const uint16_t lookupTableTwBulb[256] PROGMEM = {
+	0, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63, 65, 66, 67, 68, 69, 70, 
+	72, 73, 74, 75, 77, 78, 79, 80, 82, 83, 84, 86, 87, 88, 90, 91, 92, 94, 95, 97, 98, 100, 101, 103, 104, 106, 107, 109, 110, 112, 114, 115, 117, 119, 120, 
+	122, 124, 126, 127, 129, 131, 133, 135, 137, 138, 140, 142, 144, 146, 148, 150, 152, 155, 157, 159, 161, 163, 165, 168, 170, 172, 175, 177, 179, 182, 184, 
+	187, 189, 192, 194, 197, 199, 202, 205, 207, 210, 213, 215, 218, 221, 224, 227, 230, 233, 236, 239, 242, 245, 248, 251, 255, 258, 261, 264, 268, 271, 274, 
+	278, 281, 285, 289, 292, 296, 299, 303, 307, 311, 314, 318, 322, 326, 330, 334, 338, 342, 347, 351, 355, 359, 364, 368, 372, 377, 381, 386, 390, 395, 400, 
+	404, 409, 414, 419, 424, 428, 433, 438, 443, 449, 454, 459, 464, 470, 475, 480, 486, 491, 497, 502, 508, 514, 519, 525, 531, 537, 543, 549, 555, 561, 567, 
+	573, 580, 586, 592, 599, 605, 612, 618, 625, 632, 638, 645, 652, 659, 666, 673, 680, 687, 694, 702, 709, 716, 724, 731, 739, 746, 754, 762, 770, 778, 785, 
+	793, 801, 810, 818, 826, 834, 843, 851, 859, 868, 877, 885, 894, 903, 912, 920, 929, 938, 948, 957, 966, 975, 985, 994, 1004, 1013, 1023 };
+
+// PWM clocks of the supported platforms, the resolution is limited to 16 bit as duties are uint16_t
+const pwm_clock_t pwmClockEsp32 = {80000000, 1, 40000000, 14, true}; // LEDC with APB clock, 14 bit on all ESP32 variants
+const pwm_clock_t pwmClockEsp8266 = {1000000, 100, 40000, 16, false}; // waveform generator of core 3.x with 1 us timing
+const pwm_clock_t pwmClockBeken = {26000000, 1, 100000, 16, false};   // LibreTiny on Beken BK72xx
+
+// read a PWM duty from a lookup table in flash
+static inline uint16_t lut(const uint16_t *table, uint8_t index)
+{
+	return pgm_read_word(&table[index]);
+}
+
+// apply an __easing curve to a fixed point progress 0..256
+static uint16_t ease(uint8_t easing, uint16_t p)
+{
+	switch (easing)
+	{
+	case EASE_IN:
+		return (p * p) >> 8;
+	case EASE_OUT:
+		return 256 - (((256 - p) * (256 - p)) >> 8);
+	case EASE_IN_OUT:
+		return ((uint32_t)p * p * (768 - 2 * p)) >> 16;
+	}
+	return p;
+}
+
+uint64_t KnxLed::powerBudget = 0;
+uint64_t KnxLed::powerDemand = 0;
+uint16_t KnxLed::powerScale = 1024;
+uint8_t KnxLed::globalPowerScaleGeneration = 0;
+
+static uint32_t millisClock()
+{
+	return millis();
+}
+clockSource *KnxLed::clockFctn = millisClock;
+KnxLedBatch *KnxLed::renderBatch = nullptr;
+uint32_t KnxLed::clockOffset = 0;
+
+// built-in effects, frames are counted with 50 fps
+static const keyframe_t effectColorLoop[] PROGMEM = {
+	{0, EASE_LINEAR, 0, 255, 255, 0},
+	{500, EASE_LINEAR, 85, 255, 255, 0},
+	{500, EASE_LINEAR, 170, 255, 255, 0},
+	{500, EASE_LINEAR, 0, 255, 255, 0}};
+
+static const keyframe_t effectSunrise[] PROGMEM = {
+	{0, EASE_LINEAR, 0, 255, MIN_BRIGHTNESS, 0},
+	{3000, EASE_IN, 20, 230, 80, 0},
+	{6000, EASE_LINEAR, 0, 0, 160, 2700},
+	{12000, EASE_OUT, 0, 0, 255, 5000}};
+
+static const keyframe_t effectSunset[] PROGMEM = {
+	{3000, EASE_IN_OUT, 0, 0, 160, 2700},
+	{6000, EASE_LINEAR, 15, 240, 60, 0},
+	{6000, EASE_OUT, 0, 255, 0, 0}};
+
+static const keyframe_t effectBreathing[] PROGMEM = {
+	{100, EASE_IN_OUT | KEYFRAME_KEEP_COLOR, 0, 0, 40, 0},
+	{100, EASE_IN_OUT | KEYFRAME_KEEP_COLOR, 0, 0, 255, 0}};
+
+static const effect_t builtinEffects[] PROGMEM = {
+	{effectColorLoop, sizeof(effectColorLoop) / sizeof(keyframe_t), true},
+	{effectSunrise, sizeof(effectSunrise) / sizeof(keyframe_t), false},
+	{effectSunset, sizeof(effectSunset) / sizeof(keyframe_t), false},
+	{effectBreathing, sizeof(effectBreathing) / sizeof(keyframe_t), true}};
+
+KnxLed::KnxLed()
+{
+	initialized = false;
+	isTwBipolar = false;
+	isTwTempCh = false;
+	warmRestart = false;
+	latchedUpdate = false;
+	latchedAutoCommit = true;
+	dimmEasing = EASE_LINEAR;
+	rewriteOutputs = false;
+	scheduleOverride = false;
+	warmRestored = false;
+}
+
+// frees the allocated state and takes the channels out of the power budget
+KnxLed::~KnxLed()
+{
+	for (uint8_t ch = 0; ch < 5; ch++)
+	{
+		powerDemand -= (uint64_t)channelCurrent[ch] * requestedDuty[ch];
+	}
+	updatePowerScale();
+	delete scenes;
+	delete colorFade;
+	delete[] dimmCurve;
+	delete syncFade;
+}
+
 void KnxLed::switchLight(bool state)
 {
+	onCommand(TRACE_SWITCH, state);
+	commandDepth++;
 	switch (lightType)
 	{
 	case SWITCHABLE:
@@ -102,6 +234,7 @@ void KnxLed::switchLight(bool state)
 		break;
 	}
 	}
+	commandDepth--;
 }
 
 void KnxLed::setBrightness(uint8_t brightness)
@@ -111,6 +244,8 @@ void KnxLed::setBrightness(uint8_t brightness)
 
 void KnxLed::setBrightness(uint8_t brightness, bool saveValue)
 {
+	onCommand(TRACE_BRIGHTNESS, brightness, saveValue);
+	effect.count = 0;
 	if (brightness != setpointBrightness)
 	{
 		setpointBrightness = constrain(brightness, 0, MAX_BRIGHTNESS);
@@ -127,10 +262,14 @@ void KnxLed::setBrightness(uint8_t brightness, bool saveValue)
 
 void KnxLed::setTemperature(uint16_t temperature)
 {
+	onCommand(TRACE_TEMPERATURE, temperature & 0xFF, temperature >> 8);
+	effect.count = 0;
 	setpointTemperature = constrain(temperature, 2700, 6500);
 	returnTemperature();
 	relDimmCmd.dimMode = IDLE;
 	relTemperatureCmd.dimMode = IDLE;
+	relHueCmd.dimMode = IDLE;
+	relSaturationCmd.dimMode = IDLE;
 	if (currentLightMode != MODE_CCT)
 	{
 		actTemperature = setpointTemperature;
@@ -150,6 +289,8 @@ void KnxLed::setTemperature(uint16_t temperature)
 // set RGB value. This will be converted to HSV internally
 void KnxLed::setRgb(rgb_t rgb)
 {
+	onCommand(TRACE_RGB, rgb.red, rgb.green, rgb.blue);
+	commandDepth++;
 	hsv_t _hsv;
 	if (rgb.red + rgb.green + rgb.blue == 0)
 	{
@@ -167,23 +308,31 @@ void KnxLed::setRgb(rgb_t rgb)
 		_hsv.v = setpointHsv.v;
 	}
 	setHsv(_hsv);
+	commandDepth--;
 }
 
 // set HSV value.
 void KnxLed::setHsv(hsv_t hsv)
 {
+	onCommand(TRACE_HSV, hsv.h, hsv.s, hsv.v);
+	commandDepth++;
+	effect.count = 0;
 	setpointHsv = hsv;
 	if (actHsv.v == 0)
 	{
 		actHsv.h = hsv.h;
 		actHsv.s = hsv.s;
 	}
+	keepRgbwLevel();
 
 	returnColors();
 	relDimmCmd.dimMode = IDLE;
 	relTemperatureCmd.dimMode = IDLE;
+	relHueCmd.dimMode = IDLE;
+	relSaturationCmd.dimMode = IDLE;
 	currentLightMode = MODE_RGB;
 	setBrightness(hsv.v);
+	commandDepth--;
 }
 
 void KnxLed::configDefaultBrightness(uint8_t brightness)
@@ -221,13 +370,274 @@ void KnxLed::configDimmSpeed(uint8_t dimmSetSpeed)
 	dimmSpeed = dimmSetSpeed;
 }
 
+// INTERPOLATE_LINEAR blends the PWM duties of the old and the new color (both at full value) on a straight line and
+// takes hue and saturation of each step, the value V of the blend is dropped. Opposite colors therefore pass
+// through a desaturated, nearly white middle, e.g. red to cyan, and the brightness is kept by V only.
+void KnxLed::configColorInterpolation(__colorInterpolation interpolation)
+{
+	if (interpolation == INTERPOLATE_LINEAR && colorFade == nullptr)
+	{
+		colorFade = new color_fade_t;
+		colorFade->steps = 0;
+	}
+	else if (interpolation == INTERPOLATE_HSV && colorFade != nullptr)
+	{
+		delete colorFade;
+		colorFade = nullptr;
+	}
+}
+
+void KnxLed::configDimmCurve(__dimmCurve curve)
+{
+	derived.valid &= ~DERIVED_CCT; // duties of the old curve
+	if (curve == CURVE_DEFAULT)
+	{
+		delete[] dimmCurve;
+		dimmCurve = nullptr;
+		return;
+	}
+	if (dimmCurve == nullptr)
+	{
+		dimmCurve = new uint16_t[256];
+	}
+	dimmCurve[0] = 0;
+	for (uint16_t i = 1; i < 256; i++)
+	{
+		float y;
+		switch (curve)
+		{
+		case CURVE_CIE_LSTAR:
+		{
+			float l = i * 100.0f / 255;
+			y = l <= 8 ? l / 903.3f : powf((l + 16) / 116, 3);
+			break;
+		}
+		case CURVE_LOGARITHMIC:
+			y = powf(10, 3.0f * (i - 255) / 254);
+			break;
+		default:
+			y = i / 255.0f;
+			break;
+		}
+		dimmCurve[i] = y * 1023 + 0.5f;
+	}
+}
+
+// Custom curve through the duties (0..1023) at the values 0, 16, 32 ... 255, e.g. measured with a lux meter.
+// The points have to be ascending, the monotone cubic spline (Fritsch-Carlson) between them does not overshoot.
+void KnxLed::configDimmCurve(const uint16_t points[DIMM_CURVE_POINTS])
+{
+	derived.valid &= ~DERIVED_CCT;
+	const uint8_t n = DIMM_CURVE_POINTS;
+	float tangent[n];
+	for (uint8_t k = 0; k < n; k++)
+	{
+		float before = k > 0 ? points[k] - points[k - 1] : points[1] - points[0];
+		float after = k < n - 1 ? points[k + 1] - points[k] : before;
+		tangent[k] = before * after <= 0 ? 0 : (before + after) / 2;
+	}
+	for (uint8_t k = 0; k < n - 1; k++)
+	{
+		float delta = points[k + 1] - points[k];
+		if (delta == 0)
+		{
+			tangent[k] = 0;
+			tangent[k + 1] = 0;
+			continue;
+		}
+		float a = tangent[k] / delta;
+		float b = tangent[k + 1] / delta;
+		if (a * a + b * b > 9)
+		{
+			float tau = 3 / sqrtf(a * a + b * b);
+			tangent[k] = tau * a * delta;
+			tangent[k + 1] = tau * b * delta;
+		}
+	}
+
+	if (dimmCurve == nullptr)
+	{
+		dimmCurve = new uint16_t[256];
+	}
+	for (uint16_t i = 0; i < 256; i++)
+	{
+		float x = i * (n - 1) / 255.0f;
+		uint8_t k = min<uint8_t>(x, n - 2);
+		float t = x - k;
+		float t2 = t * t;
+		float t3 = t2 * t;
+		float y = (2 * t3 - 3 * t2 + 1) * points[k] + (t3 - 2 * t2 + t) * tangent[k] + (-2 * t3 + 3 * t2) * points[k + 1] + (t3 - t2) * tangent[k + 1];
+		dimmCurve[i] = constrain(y, 0, 1023) + 0.5f;
+	}
+}
+
+// easing of brightness transitions, the duration stays one tick per brightness step
+void KnxLed::configDimmEasing(__easing easing)
+{
+	dimmEasing = easing;
+	easeFrom = actBrightness;
+	easeLinear = actBrightness;
+	easeTarget = actBrightness;
+}
+
+// In latched mode all channel duties of one pwmControl() run are staged and applied together,
+// so a PWM period never shows a mix of old and new duties.
+// Without autoCommit, commitPwm() has to be called by the application (e.g. for a group of lights).
+void KnxLed::configLatchedUpdate(bool latched, bool autoCommit)
+{
+	latchedUpdate = latched;
+	latchedAutoCommit = autoCommit;
+}
+
+// Restore the previous state after a software, watchdog or OTA reset, so the outputs continue with the previous duty.
+// Must be called before init*Light(). Lights must be initialized in the same order on every boot.
+void KnxLed::configWarmRestart(bool enable)
+{
+	warmRestart = enable;
+}
+
+// current of one output channel at full duty in mA. Used to estimate the load for the power budget.
+void KnxLed::configChannelCurrent(uint8_t channel, uint16_t current)
+{
+	if (channel < 5)
+	{
+		powerDemand -= (uint64_t)channelCurrent[channel] * requestedDuty[channel];
+		channelCurrent[channel] = current;
+		powerDemand += (uint64_t)channelCurrent[channel] * requestedDuty[channel];
+		updatePowerScale();
+	}
+}
+
+// maximum current of the power supply in mA shared by all lights, 0 = no limit.
+// If the estimated current exceeds the budget, all lights are dimmed down proportionally.
+void KnxLed::configPowerBudget(uint32_t maxCurrent)
+{
+	powerBudget = (uint64_t)maxCurrent * 1023;
+	updatePowerScale();
+}
+
+// estimated current in mA of all lights without power budget limitation
+uint32_t KnxLed::getCurrentDemand()
+{
+	return powerDemand / 1023;
+}
+
+// Transitions take the given time (ms) and are calculated from the shared clock instead of counting loop() calls.
+// All lights with the same clock and duration show the same transition for the same command.
+// 0 = one step per loop() call (default). Relative dimming and effects always use the loop() based steps.
+void KnxLed::configSyncedTransition(uint16_t duration)
+{
+	if (duration == 0)
+	{
+		delete syncFade;
+		syncFade = nullptr;
+		return;
+	}
+	if (syncFade == nullptr)
+	{
+		// a transition from the current values, nothing moves if they already are at the setpoints
+		syncFade = new sync_fade_t();
+		syncFade->commandTime = getClock();
+		syncFade->start = syncFade->commandTime;
+		syncFade->from.brightness = actBrightness;
+		syncFade->from.temperature = actTemperature;
+		syncFade->from.hsv = actHsv;
+		syncFade->to.brightness = setpointBrightness;
+		syncFade->to.temperature = setpointTemperature;
+		syncFade->to.hsv = {setpointHsv.h, setpointHsv.s, targetValue()};
+	}
+	syncFade->duration = duration;
+}
+
+// Start time (shared clock) of the transition caused by the next command instead of the time of the command,
+// e.g. the time the group telegram was received, which is the same for all lights of the device
+void KnxLed::setTransitionStart(uint32_t startTime)
+{
+	if (syncFade != nullptr)
+	{
+		syncFade->pendingStart = startTime;
+		syncFade->startPending = true;
+	}
+}
+
+// clock used for the shared time and the effect frames, e.g. a simulated clock. Default is millis()
+void KnxLed::configClockSource(clockSource *source)
+{
+	clockFctn = source;
+}
+
+// set the shared time (ms) of all lights
+void KnxLed::setClock(uint32_t time)
+{
+	clockOffset = time - clockFctn();
+}
+
+// Set the shared time from a KNX DPT 19.001 date/time telegram (8 bytes), so several devices use the same time base.
+// The time is counted in ms since 1900-01-01 (or since midnight without date) and wraps around after 49 days.
+bool KnxLed::setClockDpt19(const uint8_t *dpt19)
+{
+	// flags: bit 7 = fault, bit 3 = no date, bit 1 = no time
+	if ((dpt19[6] & 0x80) || (dpt19[6] & 0x02))
+	{
+		return false;
+	}
+	uint32_t days = 0;
+	if (!(dpt19[6] & 0x08))
+	{
+		// days since 1900-01-01 (civil from days algorithm, March based year)
+		uint16_t year = 1900 + dpt19[0];
+		uint8_t month = dpt19[1] & 0x0F;
+		uint8_t day = dpt19[2] & 0x1F;
+		if (month < 1 || month > 12 || day < 1)
+		{
+			return false;
+		}
+		if (month <= 2)
+		{
+			year--;
+		}
+		uint16_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+		days = 365UL * year + year / 4 - year / 100 + year / 400 + dayOfYear - 693901UL;
+	}
+	uint32_t seconds = (dpt19[3] & 0x1F) * 3600UL + (dpt19[4] & 0x3F) * 60UL + (dpt19[5] & 0x3F);
+	setClock((uint32_t)(((uint64_t)days * 86400 + seconds) * 1000));
+	return true;
+}
+
+uint32_t KnxLed::getClock()
+{
+	return clockFctn() + clockOffset;
+}
+
+// DPT 3.007: steps 1..7 = 100%, 50%, 25%, ... 1.56% of the range. Returns the number of dimming steps
+// for the interval (0 = until STOP) and lets the first step happen in the next fade() instead of after dimmSpeed loops
+uint8_t KnxLed::dpt3StepCount(dpt3_t cmd, uint16_t range)
+{
+	if (cmd.dimMode != UP && cmd.dimMode != DOWN)
+	{
+		return 0;
+	}
+	dimmCount = dimmSpeed;
+	if (cmd.steps == 0)
+	{
+		return 0;
+	}
+	return max(1, (range + ((1 << (cmd.steps - 1)) >> 1)) >> (cmd.steps - 1));
+}
+
 void KnxLed::setRelDimmCmd(dpt3_t dimmCmd)
 {
+	onCommand(TRACE_REL_DIMM, dimmCmd.toDPT3());
+	effect.count = 0;
 	relDimmCmd = dimmCmd;
+	relDimmSteps = dpt3StepCount(dimmCmd, 255);
 }
 
 void KnxLed::setRelTemperatureCmd(dpt3_t temperatureCmd)
 {
+	onCommand(TRACE_REL_TEMPERATURE, temperatureCmd.toDPT3());
+	commandDepth++;
+	effect.count = 0;
 	if(temperatureCmd.dimMode != STOP)
 	{
 		if (currentLightMode != MODE_CCT)
@@ -236,10 +646,15 @@ void KnxLed::setRelTemperatureCmd(dpt3_t temperatureCmd)
 		}
 	}
 	relTemperatureCmd = temperatureCmd;
+	relTemperatureSteps = dpt3StepCount(temperatureCmd, (6500 - 2700) / 20);
+	commandDepth--;
 }
 
 void KnxLed::setRelHueCmd(dpt3_t hueCmd)
 {
+	onCommand(TRACE_REL_HUE, hueCmd.toDPT3());
+	commandDepth++;
+	effect.count = 0;
 	if(hueCmd.dimMode != STOP)
 	{
 		if (currentLightMode != MODE_RGB)
@@ -254,11 +669,15 @@ void KnxLed::setRelHueCmd(dpt3_t hueCmd)
 		}
 	}
 	relHueCmd = hueCmd;
+	relHueSteps = dpt3StepCount(hueCmd, 255);
+	commandDepth--;
 }
 
 void KnxLed::setRelSaturationCmd(dpt3_t saturationCmd)
 {
-	relSaturationCmd = saturationCmd;
+	onCommand(TRACE_REL_SATURATION, saturationCmd.toDPT3());
+	commandDepth++;
+	effect.count = 0;
 	if(saturationCmd.dimMode != STOP)
 	{
 		if (currentLightMode != MODE_RGB)
@@ -268,13 +687,346 @@ void KnxLed::setRelSaturationCmd(dpt3_t saturationCmd)
 			setHsv(_hsv);
 		}
 	}
+	relSaturationCmd = saturationCmd;
+	relSaturationSteps = dpt3StepCount(saturationCmd, 255);
+	commandDepth--;
+}
+
+// start a built-in effect (Effects). 0 or an unknown number stops the running effect
+void KnxLed::setEffect(uint8_t effectNumber)
+{
+	onCommand(TRACE_EFFECT, effectNumber);
+	commandDepth++;
+	if (effectNumber == EFFECT_NONE || effectNumber > sizeof(builtinEffects) / sizeof(effect_t))
+	{
+		stopEffect();
+	}
+	else
+	{
+		effect_t builtinEffect;
+		memcpy_P(&builtinEffect, &builtinEffects[effectNumber - 1], sizeof(effect_t));
+		playEffect(builtinEffect);
+		this->effectNumber = effectNumber;
+	}
+	commandDepth--;
+}
+
+// start a user defined keyframe sequence. The keyframes must stay valid while the effect is running
+void KnxLed::playEffect(const effect_t &customEffect)
+{
+	relDimmCmd.dimMode = IDLE;
+	relTemperatureCmd.dimMode = IDLE;
+	relHueCmd.dimMode = IDLE;
+	relSaturationCmd.dimMode = IDLE;
+	effect = customEffect;
+	effectNumber = EFFECT_CUSTOM;
+	effectKeyframe = 0;
+	effectLastFrame = clockFctn();
+	if (effect.count > 0)
+	{
+		startKeyframe();
+		renderEffect(0);
+	}
+}
+
+// stop the running effect, the light keeps its current state
+void KnxLed::stopEffect()
+{
+	onCommand(TRACE_EFFECT, EFFECT_NONE);
+	effectNumber = EFFECT_NONE;
+	if (effect.count > 0)
+	{
+		effect.count = 0;
+		sendStatusUpdate();
+	}
+}
+
+// load the next keyframe and resolve it for the capabilities of this light
+void KnxLed::startKeyframe()
+{
+	memcpy_P(&effectTo, &effect.keyframes[effectKeyframe], sizeof(keyframe_t));
+	effectFrom.h = setpointHsv.h;
+	effectFrom.s = setpointHsv.s;
+	effectFrom.v = setpointBrightness;
+	effectFrom.temperature = currentLightMode == MODE_CCT && lightType != RGB ? setpointTemperature : 0;
+	effectFrame = 0;
+
+	if ((effectTo.easing & KEYFRAME_KEEP_COLOR) || lightType == DIMMABLE || lightType == SWITCHABLE)
+	{
+		effectTo.h = effectFrom.h;
+		effectTo.s = effectFrom.s;
+		effectTo.temperature = effectFrom.temperature;
+	}
+	else if (lightType == TUNABLEWHITE && effectTo.temperature == 0)
+	{
+		// no color channels, only brightness is animated
+		effectTo.temperature = setpointTemperature;
+	}
+	else if (lightType == RGB && effectTo.temperature > 0)
+	{
+		// no separate CCT channels, color temperature is converted once per keyframe
+		rgb_t _rgb;
+		hsv_t _hsv;
+		kelvin2rgb(effectTo.temperature, MAX_BRIGHTNESS, _rgb);
+		rgb2hsv(_rgb, _hsv);
+		effectTo.h = _hsv.h;
+		effectTo.s = _hsv.s;
+		effectTo.temperature = 0;
+	}
+
+	// switching between CCT and RGB mode is done at the start of the keyframe, only brightness is faded
+	if (effectTo.temperature > 0 && effectFrom.temperature == 0)
+	{
+		effectFrom.temperature = effectTo.temperature;
+		if (currentLightMode != MODE_CCT)
+		{
+			actTemperature = effectTo.temperature;
+			currentLightMode = MODE_CCT;
+		}
+	}
+	else if (effectTo.temperature == 0 && (effectFrom.temperature > 0 || effectFrom.v == 0))
+	{
+		effectFrom.h = effectTo.h;
+		effectFrom.s = effectTo.s;
+		actHsv.h = effectTo.h;
+		actHsv.s = effectTo.s;
+		currentLightMode = MODE_RGB;
+	}
+}
+
+// advance the running effect by the given number of frames and update the setpoints
+void KnxLed::renderEffect(uint16_t frames)
+{
+	effectFrame = min<uint32_t>(effectFrame + frames, 0xFFFF);
+	uint8_t keyframesApplied = 0;
+	while (effectFrame >= effectTo.frames)
+	{
+		applyEffectValues(effectTo.h, effectTo.s, effectTo.v, effectTo.temperature);
+		effectFrame -= effectTo.frames;
+		if (++effectKeyframe >= effect.count)
+		{
+			if (!effect.repeat)
+			{
+				effect.count = 0;
+				effectNumber = EFFECT_NONE;
+				sendStatusUpdate();
+				return;
+			}
+			effectKeyframe = 0;
+		}
+		uint16_t remainingFrames = effectFrame;
+		startKeyframe();
+		effectFrame = remainingFrames;
+		// a sequence of keyframes without duration would never end
+		if (++keyframesApplied > effect.count)
+		{
+			effectFrame = 0;
+			return;
+		}
+	}
+
+	// fixed point progress 0..256 with easing
+	uint16_t p = ease(effectTo.easing & ~KEYFRAME_KEEP_COLOR, ((uint32_t)effectFrame << 8) / effectTo.frames);
+
+	int16_t diffH = (int8_t)(effectTo.h - effectFrom.h); // shortest way around the color wheel
+	uint8_t h = effectFrom.h + ((diffH * p) >> 8);
+	uint8_t s = effectFrom.s + (((effectTo.s - effectFrom.s) * p) >> 8);
+	uint8_t v = effectFrom.v + (((effectTo.v - effectFrom.v) * p) >> 8);
+	uint16_t temperature = effectFrom.temperature + (((int32_t)(effectTo.temperature - effectFrom.temperature) * p) >> 8);
+	applyEffectValues(h, s, v, temperature);
+}
+
+// set the setpoints without feedback, fade() does the transition
+void KnxLed::applyEffectValues(uint8_t h, uint8_t s, uint8_t v, uint16_t temperature)
+{
+	setpointBrightness = v;
+	setpointHsv.v = v;
+	if (temperature > 0)
+	{
+		setpointTemperature = temperature;
+	}
+	else
+	{
+		setpointHsv.h = h;
+		setpointHsv.s = s;
+	}
+}
+
+// DPT 18.001: bit 7 = learn, bits 0-5 = scene number 0..63
+void KnxLed::setScene(uint8_t sceneCmd)
+{
+	if (sceneCmd & 0x80)
+	{
+		learnScene(sceneCmd & 0x3F);
+	}
+	else
+	{
+		recallScene(sceneCmd & 0x3F);
+	}
+}
+
+// DPT 17.001: apply all values of the scene at once and start one transition
+void KnxLed::recallScene(uint8_t sceneNumber)
+{
+	onCommand(TRACE_RECALL_SCENE, sceneNumber);
+	if (scenes == nullptr || sceneNumber >= SCENE_COUNT || scenes->scene[sceneNumber].temperature == SCENE_EMPTY)
+	{
+		return;
+	}
+	const scene_t &scene = scenes->scene[sceneNumber];
+	effect.count = 0;
+	relDimmCmd.dimMode = IDLE;
+	relTemperatureCmd.dimMode = IDLE;
+	relHueCmd.dimMode = IDLE;
+	relSaturationCmd.dimMode = IDLE;
+
+	setpointBrightness = scene.v;
+	setpointHsv.v = scene.v;
+	if (scene.temperature == SCENE_RGB)
+	{
+		setpointHsv.h = scene.h;
+		setpointHsv.s = scene.s;
+		if (actHsv.v == 0)
+		{
+			actHsv.h = scene.h;
+			actHsv.s = scene.s;
+		}
+		keepRgbwLevel();
+		currentLightMode = MODE_RGB;
+		if (scene.v > 0)
+		{
+			savedHsv = setpointHsv;
+		}
+		returnColors();
+	}
+	else
+	{
+		setpointTemperature = 2700 + scene.temperature * 20;
+		if (currentLightMode != MODE_CCT)
+		{
+			actTemperature = setpointTemperature;
+			currentLightMode = MODE_CCT;
+		}
+		returnTemperature();
+	}
+	if (scene.v > 0)
+	{
+		savedBrightness = scene.v;
+	}
+	returnBrightness();
+}
+
+// store the current setpoints in the scene
+void KnxLed::learnScene(uint8_t sceneNumber)
+{
+	onCommand(TRACE_LEARN_SCENE, sceneNumber);
+	if (sceneNumber >= SCENE_COUNT)
+	{
+		return;
+	}
+	scene_t scene;
+	scene.v = setpointBrightness;
+	if (lightType == RGB || ((lightType == RGBW || lightType == RGBCT) && currentLightMode == MODE_RGB))
+	{
+		scene.h = setpointHsv.h;
+		scene.s = setpointHsv.s;
+		scene.temperature = SCENE_RGB;
+	}
+	else
+	{
+		scene.h = 0;
+		scene.s = 0;
+		scene.temperature = (setpointTemperature - 2700) / 20;
+	}
+	setSceneData(sceneNumber, scene);
+}
+
+// raw scene access, e.g. to persist scenes. Returns false if the scene was not learned
+bool KnxLed::getSceneData(uint8_t sceneNumber, scene_t &scene)
+{
+	if (scenes == nullptr || sceneNumber >= SCENE_COUNT || scenes->scene[sceneNumber].temperature == SCENE_EMPTY)
+	{
+		return false;
+	}
+	scene = scenes->scene[sceneNumber];
+	return true;
+}
+
+void KnxLed::setSceneData(uint8_t sceneNumber, scene_t scene)
+{
+	if (sceneNumber >= SCENE_COUNT)
+	{
+		return;
+	}
+	if (scenes == nullptr)
+	{
+		if (scene.temperature == SCENE_EMPTY)
+		{
+			return;
+		}
+		scenes = new scene_table_t;
+		memset(scenes->scene, 0xFF, sizeof(scenes->scene));
+		scenes->changed = 0;
+	}
+	scenes->scene[sceneNumber] = scene;
+	scenes->changed |= 1ULL << sceneNumber;
+}
+
+// internal helpers for KnxLedStorage
+uint64_t KnxLed::getChangedScenes()
+{
+	return scenes != nullptr ? scenes->changed : 0;
+}
+
+void KnxLed::clearChangedScenes()
+{
+	if (scenes != nullptr)
+	{
+		scenes->changed = 0;
+	}
 }
 
 void KnxLed::loop()
 {
 	if (initialized)
 	{
+		if (trace != nullptr)
+		{
+			trace->ticks++;
+		}
+#if defined(KNXLED_STATS)
+		unsigned long now = micros();
+		if (stats.ticks > 0)
+		{
+			stats.maxLoopGap = max<uint32_t>(stats.maxLoopGap, now - lastLoop);
+		}
+		lastLoop = now;
+		uint32_t startCycles = KNXLED_CYCLES();
+#endif
+		if (effect.count > 0)
+		{
+			unsigned long frames = (clockFctn() - effectLastFrame) / EFFECT_FRAME_INTERVAL;
+			if (frames > 0)
+			{
+				effectLastFrame += frames * EFFECT_FRAME_INTERVAL;
+				renderEffect(min<unsigned long>(frames, 0xFFFF));
+			}
+		}
 		fade();
+		// power budget scale was changed by another light
+		if (powerScaleGeneration != globalPowerScaleGeneration)
+		{
+			powerScaleGeneration = globalPowerScaleGeneration;
+			rewriteOutputs = true;
+			updateOutputs();
+		}
+#if defined(KNXLED_STATS)
+		uint32_t cycles = KNXLED_CYCLES() - startCycles;
+		stats.ticks++;
+		stats.minTickCycles = min(stats.minTickCycles, cycles);
+		stats.maxTickCycles = max(stats.maxTickCycles, cycles);
+		sumTickCycles += cycles;
+#endif
 	}
 }
 
@@ -292,6 +1044,10 @@ void KnxLed::fade()
 			{
 				returnBrightness();
 			}
+			else
+			{
+				KNXLED_STATS_INC(feedbackSuppressed);
+			}
 		}
 		else if (relDimmCmd.dimMode == DOWN && actBrightness > MIN_BRIGHTNESS)
 		{
@@ -300,6 +1056,10 @@ void KnxLed::fade()
 			{
 				returnBrightness();
 			}
+			else
+			{
+				KNXLED_STATS_INC(feedbackSuppressed);
+			}
 		}
 		else if (relDimmCmd.dimMode == STOP)
 		{
@@ -307,6 +1067,11 @@ void KnxLed::fade()
 			returnBrightness();
 			relDimmCmd.dimMode = IDLE;
 		}
+		// DPT 3.007 interval finished
+		if ((relDimmCmd.dimMode == UP || relDimmCmd.dimMode == DOWN) && relDimmSteps > 0 && --relDimmSteps == 0)
+		{
+			relDimmCmd.dimMode = STOP;
+		}
 
 		if (relTemperatureCmd.dimMode == UP && actTemperature < 6500)
 		{
@@ -315,6 +1080,10 @@ void KnxLed::fade()
 			{
 				returnTemperature();
 			}
+			else
+			{
+				KNXLED_STATS_INC(feedbackSuppressed);
+			}
 		}
 		else if (relTemperatureCmd.dimMode == DOWN && actTemperature > 2700)
 		{
@@ -323,12 +1092,21 @@ void KnxLed::fade()
 			{
 				returnTemperature();
 			}
+			else
+			{
+				KNXLED_STATS_INC(feedbackSuppressed);
+			}
 		}
 		else if (relTemperatureCmd.dimMode == STOP)
 		{
 			returnTemperature();
 			relTemperatureCmd.dimMode = IDLE;
 		}
+		// DPT 3.007 interval finished
+		if ((relTemperatureCmd.dimMode == UP || relTemperatureCmd.dimMode == DOWN) && relTemperatureSteps > 0 && --relTemperatureSteps == 0)
+		{
+			relTemperatureCmd.dimMode = STOP;
+		}
 
 		if (relHueCmd.dimMode == UP)
 		{
@@ -337,6 +1115,10 @@ void KnxLed::fade()
 			{
 				returnColors();
 			}
+			else
+			{
+				KNXLED_STATS_INC(feedbackSuppressed);
+			}
 		}
 		else if (relHueCmd.dimMode == DOWN)
 		{
@@ -345,6 +1127,10 @@ void KnxLed::fade()
 			{
 				returnColors();
 			}
+			else
+			{
+				KNXLED_STATS_INC(feedbackSuppressed);
+			}
 		}
 		else if (relHueCmd.dimMode == STOP)
 		{
@@ -352,6 +1138,11 @@ void KnxLed::fade()
 			returnColors();
 			relHueCmd.dimMode = IDLE;
 		}
+		// DPT 3.007 interval finished
+		if ((relHueCmd.dimMode == UP || relHueCmd.dimMode == DOWN) && relHueSteps > 0 && --relHueSteps == 0)
+		{
+			relHueCmd.dimMode = STOP;
+		}
 
 		if (relSaturationCmd.dimMode == UP && actHsv.s < 255)
 		{
@@ -360,6 +1151,10 @@ void KnxLed::fade()
 			{
 				returnColors();
 			}
+			else
+			{
+				KNXLED_STATS_INC(feedbackSuppressed);
+			}
 		}
 		else if (relSaturationCmd.dimMode == DOWN && actHsv.s > 0)
 		{
@@ -368,6 +1163,10 @@ void KnxLed::fade()
 			{
 				returnColors();
 			}
+			else
+			{
+				KNXLED_STATS_INC(feedbackSuppressed);
+			}
 		}
 		else if (relSaturationCmd.dimMode == STOP)
 		{
@@ -375,12 +1174,51 @@ void KnxLed::fade()
 			returnColors();
 			relSaturationCmd.dimMode = IDLE;
 		}
+		// DPT 3.007 interval finished
+		if ((relSaturationCmd.dimMode == UP || relSaturationCmd.dimMode == DOWN) && relSaturationSteps > 0 && --relSaturationSteps == 0)
+		{
+			relSaturationCmd.dimMode = STOP;
+		}
 	}
 
+	bool updatePwm;
+	if (syncFade != nullptr && effect.count == 0 && !isRelativeDimming())
+	{
+		updatePwm = fadeSynced();
+	}
+	else
+	{
+		updatePwm = fadeStep();
+	}
+
+	// to avoid flickering, only update on change
+	if (updatePwm)
+	{
+		updateOutputs();
+		// the RTC memory is written after a command, when the light settles and every SNAPSHOT_INTERVAL ticks of
+		// a transition instead of on every tick
+		if (snapshotSlot < SNAPSHOT_SLOTS && (++snapshotTicks >= SNAPSHOT_INTERVAL || isSettled()))
+		{
+			saveSnapshot();
+		}
+		if (returnStatusFctn != nullptr)
+		{
+			if ((actBrightness == 0) != (oldBrightness == 0))
+			{
+				returnStatus();
+			}
+		}
+	}
+}
+
+// one step per tick towards the setpoints
+bool KnxLed::fadeStep()
+{
 	bool updatePwm = false;
+	uint8_t prevBrightness = actBrightness;
 	if (setpointBrightness != actBrightness)
 	{
-		actBrightness += setpointBrightness > actBrightness ? 1 : -1;
+		fadeBrightness();
 		updatePwm = true;
 	}
 
@@ -395,30 +1233,37 @@ void KnxLed::fade()
 		updatePwm = true;
 	}
 
-	uint8_t diffH = abs(setpointHsv.h - actHsv.h);
-	if (diffH > 0)
+	if (colorFade != nullptr)
+	{
+		updatePwm |= fadeColorLinear();
+	}
+	else
 	{
-		bool do360overflow = diffH > 128;
-		if ((setpointHsv.h > actHsv.h) != do360overflow)
+		uint8_t diffH = abs(setpointHsv.h - actHsv.h);
+		if (diffH > 0)
 		{
-			actHsv.h = (actHsv.h + 1) % 256;
+			bool do360overflow = diffH > 128;
+			if ((setpointHsv.h > actHsv.h) != do360overflow)
+			{
+				actHsv.h = (actHsv.h + 1) % 256;
+			}
+			else
+			{
+				actHsv.h = (actHsv.h + 255) % 256;
+			}
+			updatePwm = true;
 		}
-		else
+
+		if (diffH > 43 && (setpointHsv.s - actHsv.s) < diffH && actHsv.s > 1)
 		{
-			actHsv.h = (actHsv.h + 255) % 256;
+			actHsv.s -= 2;
+			updatePwm = true;
+		}
+		else if (setpointHsv.s != actHsv.s)
+		{
+			actHsv.s += setpointHsv.s > actHsv.s ? 1 : -1;
+			updatePwm = true;
 		}
-		updatePwm = true;
-	}
-
-	if (diffH > 43 && (setpointHsv.s - actHsv.s) < diffH && actHsv.s > 1)
-	{
-		actHsv.s -= 2;
-		updatePwm = true;
-	}
-	else if (setpointHsv.s != actHsv.s)
-	{
-		actHsv.s += setpointHsv.s > actHsv.s ? 1 : -1;
-		updatePwm = true;
 	}
 
 	if (currentLightMode == MODE_CCT && (lightType == RGBCT || lightType == RGBW))
@@ -431,25 +1276,229 @@ void KnxLed::fade()
 	}
 	else
 	{
-		if (setpointBrightness != actHsv.v)
+		if (actHsv.v == prevBrightness && actBrightness != prevBrightness)
+		{
+			actHsv.v = actBrightness; // follow the eased brightness
+			updatePwm = true;
+		}
+		else if (setpointBrightness != actHsv.v)
 		{
 			actHsv.v += setpointBrightness > actHsv.v ? 1 : -1;
 			updatePwm = true;
 		}
 	}
+	return updatePwm;
+}
 
-	// to avoid flickering, only update on change
-	if (updatePwm)
+// Time based transition for synchronised lights: the position only depends on the shared clock and the
+// command time, so lights which received the same command show the same values regardless of their loop() timing
+bool KnxLed::fadeSynced()
+{
+	uint8_t targetV = targetValue();
+	if (setpointBrightness != syncFade->to.brightness || setpointTemperature != syncFade->to.temperature || targetV != syncFade->to.hsv.v ||
+		setpointHsv.h != syncFade->to.hsv.h || setpointHsv.s != syncFade->to.hsv.s)
 	{
-		pwmControl();
-		if (returnStatusFctn != nullptr)
+		syncFade->from.brightness = actBrightness;
+		syncFade->from.temperature = actTemperature;
+		syncFade->from.hsv = actHsv;
+		syncFade->to.brightness = setpointBrightness;
+		syncFade->to.temperature = setpointTemperature;
+		syncFade->to.hsv = {setpointHsv.h, setpointHsv.s, targetV};
+		syncFade->start = syncFade->commandTime;
+	}
+
+	int32_t elapsed = getClock() - syncFade->start;
+	uint16_t p = 0;
+	if (elapsed >= syncFade->duration)
+	{
+		p = 256;
+	}
+	else if (elapsed > 0)
+	{
+		p = ease(dimmEasing, ((uint32_t)elapsed << 8) / syncFade->duration);
+	}
+
+	const sync_values_t &from = syncFade->from;
+	const sync_values_t &to = syncFade->to;
+	uint8_t brightness = from.brightness + (((to.brightness - from.brightness) * p) >> 8);
+	uint16_t temperature = from.temperature + (((int32_t)(to.temperature - from.temperature) * p) >> 8);
+	int16_t diffH = (int8_t)(to.hsv.h - from.hsv.h); // shortest way around the color wheel
+	hsv_t hsv;
+	hsv.h = from.hsv.h + ((diffH * p) >> 8);
+	hsv.s = from.hsv.s + (((to.hsv.s - from.hsv.s) * p) >> 8);
+	hsv.v = from.hsv.v + (((to.hsv.v - from.hsv.v) * p) >> 8);
+
+	if (brightness == actBrightness && temperature == actTemperature && hsv.h == actHsv.h && hsv.s == actHsv.s && hsv.v == actHsv.v)
+	{
+		return false;
+	}
+	actBrightness = brightness;
+	actTemperature = temperature;
+	actHsv = hsv;
+	return true;
+}
+
+// internal helper for the switch of a RGBW light from the CCT to the RGB mode. The white channel showed the brightness,
+// the color channels start at the same level instead of fading up from black
+void KnxLed::keepRgbwLevel()
+{
+	if (lightType == RGBW && currentLightMode == MODE_CCT)
+	{
+		actHsv.v = actBrightness;
+	}
+}
+
+// actHsv.v fades to 0 while RGBW/RGBCT lights show a color temperature, otherwise it follows the brightness
+uint8_t KnxLed::targetValue()
+{
+	return currentLightMode == MODE_CCT && (lightType == RGBCT || lightType == RGBW) ? 0 : setpointBrightness;
+}
+
+// values of a KnxLedSchedule: only the setpoints move, the fade engine follows them. No feedback and no trace,
+// so the schedule isn't overridden by itself
+void KnxLed::followSchedule(uint16_t temperature, uint8_t brightness)
+{
+	bool changed = false;
+	temperature = constrain(temperature, 2700, 6500);
+	if (lightType >= TUNABLEWHITE && lightType != RGB && currentLightMode == MODE_CCT && temperature != setpointTemperature)
+	{
+		setpointTemperature = temperature;
+		changed = true;
+	}
+	// a light which is off keeps its switch on value, the schedule sets it after switching on
+	if (brightness > 0 && setpointBrightness > 0 && brightness != setpointBrightness)
+	{
+		setpointBrightness = brightness;
+		savedBrightness = brightness;
+		setpointHsv.v = brightness;
+		changed = true;
+	}
+	if (changed && syncFade != nullptr)
+	{
+		syncFade->commandTime = getClock();
+	}
+}
+
+bool KnxLed::isRelativeDimming()
+{
+	return relDimmCmd.dimMode == UP || relDimmCmd.dimMode == DOWN || relTemperatureCmd.dimMode == UP || relTemperatureCmd.dimMode == DOWN ||
+		   relHueCmd.dimMode == UP || relHueCmd.dimMode == DOWN || relSaturationCmd.dimMode == UP || relSaturationCmd.dimMode == DOWN;
+}
+
+void KnxLed::fadeBrightness()
+{
+	if (dimmEasing == EASE_LINEAR)
+	{
+		actBrightness += setpointBrightness > actBrightness ? 1 : -1;
+		return;
+	}
+	// a new setpoint starts a new transition from the current brightness
+	if (setpointBrightness != easeTarget || easeLinear == easeTarget)
+	{
+		easeFrom = actBrightness;
+		easeLinear = actBrightness;
+		easeTarget = setpointBrightness;
+	}
+	easeLinear += easeTarget > easeLinear ? 1 : -1;
+	int16_t range = easeTarget - easeFrom;
+	uint16_t p = (abs(easeLinear - easeFrom) << 8) / abs(range);
+	actBrightness = easeFrom + range * ease(dimmEasing, p) / 256;
+}
+
+// PWM duty of a channel value, the default table is used without a configured curve
+uint16_t KnxLed::curveDuty(uint8_t value, const uint16_t *defaultTable)
+{
+	return dimmCurve != nullptr ? dimmCurve[value] : lut(defaultTable, value);
+}
+
+// channel value with the PWM duty closest to duty, the curve is monotonic
+uint8_t KnxLed::curveValue(uint16_t duty)
+{
+	uint8_t low = 0;
+	uint8_t high = 255;
+	while (low < high)
+	{
+		uint8_t mid = (low + high) / 2;
+		if (curveDuty(mid) < duty)
 		{
-			if ((actBrightness == 0) != (oldBrightness == 0))
-			{
-				returnStatus();
-			}
+			low = mid + 1;
 		}
+		else
+		{
+			high = mid;
+		}
+	}
+	if (low > 0 && duty - curveDuty(low - 1) < curveDuty(low) - duty)
+	{
+		low--;
+	}
+	return low;
+}
+
+// one step of an INTERPOLATE_LINEAR transition, a new setpoint starts a new transition from the current color
+bool KnxLed::fadeColorLinear()
+{
+	if (setpointHsv.h == actHsv.h && setpointHsv.s == actHsv.s)
+	{
+		colorFade->steps = 0;
+		return false;
+	}
+
+	rgb_t _rgb;
+	if (colorFade->steps == 0 || colorFade->h != setpointHsv.h || colorFade->s != setpointHsv.s)
+	{
+		hsv2rgb({actHsv.h, actHsv.s, MAX_BRIGHTNESS}, _rgb);
+		colorFade->from[0] = curveDuty(_rgb.red);
+		colorFade->from[1] = curveDuty(_rgb.green);
+		colorFade->from[2] = curveDuty(_rgb.blue);
+		hsv2rgb({setpointHsv.h, setpointHsv.s, MAX_BRIGHTNESS}, _rgb);
+		colorFade->to[0] = curveDuty(_rgb.red);
+		colorFade->to[1] = curveDuty(_rgb.green);
+		colorFade->to[2] = curveDuty(_rgb.blue);
+		colorFade->h = setpointHsv.h;
+		colorFade->s = setpointHsv.s;
+
+		// 8 duty steps per tick, a full color change takes as long as half a turn of the color wheel in HSV mode
+		uint16_t distance = 0;
+		for (uint8_t i = 0; i < 3; i++)
+		{
+			distance = max<uint16_t>(distance, abs(colorFade->to[i] - colorFade->from[i]));
+		}
+		colorFade->steps = constrain(distance / 8, 1, 255);
+		colorFade->step = 0;
+	}
+
+	colorFade->step++;
+	if (colorFade->step >= colorFade->steps)
+	{
+		actHsv.h = setpointHsv.h;
+		actHsv.s = setpointHsv.s;
+		colorFade->steps = 0;
+		return true;
 	}
+
+	uint8_t channel[3];
+	for (uint8_t i = 0; i < 3; i++)
+	{
+		int32_t duty = colorFade->from[i] + (int32_t)(colorFade->to[i] - colorFade->from[i]) * colorFade->step / colorFade->steps;
+		channel[i] = curveValue(duty);
+	}
+	hsv_t _hsv;
+	rgb2hsv({channel[0], channel[1], channel[2]}, _hsv);
+	actHsv.h = _hsv.h;
+	actHsv.s = _hsv.s;
+	return true;
+}
+
+// pwmControl() now, or later by the KnxLedBatch which runs the loop() of this light
+void KnxLed::updateOutputs()
+{
+	if (renderBatch != nullptr)
+	{
+		renderBatch->deferred = true;
+		return;
+	}
+	pwmControl();
 }
 
 void KnxLed::pwmControl()
@@ -458,13 +1507,19 @@ void KnxLed::pwmControl()
 	{
 	case SWITCHABLE:
 	{
+		if (output != nullptr)
+		{
+			ledAnalogWrite(0, actBrightness > 0 ? 1023 : 0);
+			break;
+		}
 		digitalWrite(outputPins[0], actBrightness > 0);
+		KNXLED_STATS_INC(pwmWrites);
 		break;
 	}
 	case DIMMABLE:
 	{
 		int dutyCh0 = actBrightness;
-		ledAnalogWrite(0, lookupTable[dutyCh0]);
+		ledAnalogWrite(0, curveDuty(dutyCh0));
 		break;
 	}
 	case TUNABLEWHITE:
@@ -477,45 +1532,31 @@ void KnxLed::pwmControl()
 			int dutyCh0 = constrain((actTemperature - 2700) * maxBt, 0, 1023) + 0.5;
 			int dutyCh1 = constrain((6500 - actTemperature) * maxBt, 0, 1023) + 0.5;
 #if defined(ESP32)
-			ledc_set_duty_with_hpoint(LEDC_HIGH_SPEED_MODE, esp32LedCh[0], dutyCh0, 0);
-			ledc_set_duty_with_hpoint(LEDC_HIGH_SPEED_MODE, esp32LedCh[1], dutyCh1, dutyCh0);
-			ledc_update_duty(LEDC_HIGH_SPEED_MODE, esp32LedCh[0]);
-			ledc_update_duty(LEDC_HIGH_SPEED_MODE, esp32LedCh[1]);
+			ledAnalogWrite(0, dutyCh0, 0);
+			ledAnalogWrite(1, dutyCh1, dutyCh0);
 #else
-			// TODO
-			ledAnalogWrite(0, lookupTable[dutyCh0]);
-			ledAnalogWrite(1, lookupTable[dutyCh1]);
+			// Limitation: analogWrite() has no phase shift, both channels start at the beginning of the period.
+			// In mixed temperatures both directions of the H-bridge overlap, so BIPOLAR is only supported on ESP32
+			ledAnalogWrite(0, dutyCh0);
+			ledAnalogWrite(1, dutyCh1);
 #endif
 		}
 		else
 		{
-			uint16_t dutyCh0 = 0;
-			uint16_t dutyCh1 = 0;
-			if (!isTwTempCh)
-			{
-				dutyCh0 = constrain(min(2 * (actTemperature - 2700), 3800) / 3800.0 * actBrightness, 0, 255) + 0.5;
-				dutyCh1 = constrain(min(2 * (6500 - actTemperature), 3800) / 3800.0 * actBrightness, 0, 255) + 0.5;
-				dutyCh0 = lookupTable[dutyCh0];
-				dutyCh1 = lookupTable[dutyCh1];
-			}
-			else if (actBrightness > 0)
-			{
-				dutyCh0 = lookupTableTwBulb[actBrightness];
-				dutyCh1 = constrain((actTemperature - 2700) / 3800.0 * 1023, 0, 1023) + 0.5;
-			}
-			ledAnalogWrite(0, dutyCh0);
-			ledAnalogWrite(1, dutyCh1);
+			uint16_t duty[2];
+			cctDuties(actBrightness, duty);
+			ledAnalogWrite(0, duty[0]);
+			ledAnalogWrite(1, duty[1]);
 		}
 		break;
 	}
 	case RGB:
 	{
-		rgb_t _rgb;
-		hsv2rgb(actHsv, _rgb);
+		rgb_t _rgb = actualRgb();
 
-		ledAnalogWrite(0, lookupTable[_rgb.red]);
-		ledAnalogWrite(1, lookupTable[_rgb.green]);
-		ledAnalogWrite(2, lookupTable[_rgb.blue]);
+		ledAnalogWrite(0, curveDuty(_rgb.red));
+		ledAnalogWrite(1, curveDuty(_rgb.green));
+		ledAnalogWrite(2, curveDuty(_rgb.blue));
 		break;
 	}
 	case RGBW:
@@ -540,61 +1581,232 @@ void KnxLed::pwmControl()
 		}
 		else
 		{
-			hsv2rgb(actHsv, _rgb);
-			white = rgb2White(_rgb);
+			_rgb = actualRgb();
+			white = actualWhite();
 		}
 
-		ledAnalogWrite(0, lookupTable[_rgb.red]);
-		ledAnalogWrite(1, lookupTable[_rgb.green]);
-		ledAnalogWrite(2, lookupTable[_rgb.blue]);
-		ledAnalogWrite(3, lookupTable[white]);
+		ledAnalogWrite(0, curveDuty(_rgb.red));
+		ledAnalogWrite(1, curveDuty(_rgb.green));
+		ledAnalogWrite(2, curveDuty(_rgb.blue));
+		ledAnalogWrite(3, curveDuty(white));
 		break;
 	}
 	case RGBCT:
-		rgb_t _rgb;
-		hsv2rgb(actHsv, _rgb);
+		rgb_t _rgb = actualRgb();
 		// Serial.printf("PWM IST: R=%3d,G=%3d,B=%3d H=%3d,S=%3d,V=%3d\n", _rgb.red, _rgb.green, _rgb.blue, actHsv.h, actHsv.s, actHsv.v);
 
-		ledAnalogWrite(0, lookupTable[_rgb.red]);
-		ledAnalogWrite(1, lookupTable[_rgb.green]);
-		ledAnalogWrite(2, lookupTable[_rgb.blue]);
-		uint16_t dutyCh3 = 0;
-		uint16_t dutyCh4 = 0;
+		ledAnalogWrite(0, curveDuty(_rgb.red));
+		ledAnalogWrite(1, curveDuty(_rgb.green));
+		ledAnalogWrite(2, curveDuty(_rgb.blue));
+		uint16_t duty[2];
+		cctDuties(constrain(actBrightness - actHsv.v, 0, 255), duty);
+		ledAnalogWrite(3, duty[0]);
+		ledAnalogWrite(4, duty[1]);
+	}
+
+	if (latchedUpdate && latchedAutoCommit)
+	{
+		commitPwm();
+	}
+	rewriteOutputs = false;
+}
 
-		if (!isTwTempCh)
+void KnxLed::ledAnalogWrite(byte channel, uint16_t duty, uint16_t hpoint)
+{
+	// the PWM already has this duty and no phase shift, a phase shift may have changed though
+#if defined(ESP32)
+	bool unshifted = hpoint == 0 && !(shiftedChannels & (1 << channel));
+#else
+	bool unshifted = hpoint == 0;
+#endif
+	if (duty == requestedDuty[channel] && unshifted && !rewriteOutputs)
+	{
+		return;
+	}
+	KNXLED_STATS_INC(pwmWrites);
+	if (duty != requestedDuty[channel])
+	{
+		if (channelCurrent[channel] > 0)
 		{
-			dutyCh3 = constrain(min(2 * (actTemperature - 2700), 3800) / 3800.0 * (actBrightness - actHsv.v), 0, 255) + 0.5;
-			dutyCh4 = constrain(min(2 * (6500 - actTemperature), 3800) / 3800.0 * (actBrightness - actHsv.v), 0, 255) + 0.5;
-			dutyCh3 = lookupTable[dutyCh3];
-			dutyCh4 = lookupTable[dutyCh4];		
+			updatePowerDemand(channel, duty);
 		}
-		else if (actBrightness > actHsv.v)
+		requestedDuty[channel] = duty;
+		if (trace != nullptr && trace->recordDuties)
 		{
-			dutyCh3 = lookupTableTwBulb[constrain(actBrightness - actHsv.v, 0, 255)];
-			dutyCh4 = constrain((actTemperature - 2700) / 3800.0 * 1023, 0, 1023) + 0.5;
+			trace->record(TRACE_DUTY, channel, duty & 0xFF, duty >> 8);
 		}
-		ledAnalogWrite(3, dutyCh3);
-		ledAnalogWrite(4, dutyCh4);
 	}
+	if (powerScale < 1024)
+	{
+		duty = ((uint32_t)duty * powerScale) >> 10;
+		hpoint = ((uint32_t)hpoint * powerScale) >> 10;
+	}
+
+	if (output != nullptr)
+	{
+		// backends send the changes of a tick at once, so latching is not needed
+		output->write(outputPins[channel], duty);
+		return;
+	}
+
+	if (latchedUpdate)
+	{
+		stagedDuty[channel] = duty;
+#if defined(ESP32)
+		stagedHpoint[channel] = hpoint;
+		shiftedChannels = hpoint > 0 ? shiftedChannels | (1 << channel) : shiftedChannels & ~(1 << channel);
+#endif
+		stagedChannels |= 1 << channel;
+		return;
+	}
+	writePwm(channel, duty, hpoint);
 }
 
-void KnxLed::ledAnalogWrite(byte channel, uint16_t duty)
+// hand a duty with power budget scaling applied to the PWM of the SoC
+void KnxLed::writePwm(byte channel, uint16_t duty, uint16_t hpoint)
 {
 #if defined(ESP32)
-	ledcWrite(esp32LedCh[channel], duty);
+	// ledcWrite() keeps the hpoint of the channel, so a shifted channel is set back to hpoint 0 explicitly
+	if (hpoint > 0 || (shiftedChannels & (1 << channel)))
+	{
+		ledc_set_duty_with_hpoint(ESP32_LEDC_MODE(esp32LedCh[channel]), ESP32_LEDC_CHANNEL(esp32LedCh[channel]), pwmDuty(duty), pwmDuty(hpoint));
+		ledc_update_duty(ESP32_LEDC_MODE(esp32LedCh[channel]), ESP32_LEDC_CHANNEL(esp32LedCh[channel]));
+	}
+	else
+	{
+		ledcWrite(esp32LedCh[channel], pwmDuty(duty));
+	}
+	shiftedChannels = hpoint > 0 ? shiftedChannels | (1 << channel) : shiftedChannels & ~(1 << channel);
 #elif defined(LIBRETINY)
 	// on Beken hardware, for some reason the LED will flicker if the PWM value changes from 1022 to 1023
-	// therefore limit the value to 1022
-	if(duty == 1023)
+	// therefore limit the value to 1022 (or the highest duty - 1 of another resolution)
+	uint32_t maxDuty = (1UL << pwmResolution) - 1;
+	uint32_t scaledDuty = pwmDuty(duty);
+	if(scaledDuty == maxDuty)
 	{
-		duty = 1022;
+		scaledDuty = maxDuty - 1;
 	}
-	analogWrite(outputPins[channel], duty);
+	analogWrite(outputPins[channel], scaledDuty);
+	(void)hpoint; // no phase shift
 #else
-	analogWrite(outputPins[channel], duty);
+	analogWrite(outputPins[channel], pwmDuty(duty));
+	(void)hpoint; // no phase shift
 #endif
 }
 
+// 10 bit duty of the light to the resolution of the PWM
+uint32_t KnxLed::pwmDuty(uint16_t duty)
+{
+	if (pwmResolution == 10)
+	{
+		return duty;
+	}
+	return ((uint32_t)duty * ((1UL << pwmResolution) - 1) + 511) / 1023;
+}
+
+// keep the running sum of the estimated current up to date, only the changed channel is taken into account
+void KnxLed::updatePowerDemand(byte channel, uint16_t duty)
+{
+	powerDemand -= (uint64_t)channelCurrent[channel] * requestedDuty[channel];
+	powerDemand += (uint64_t)channelCurrent[channel] * duty;
+	updatePowerScale();
+}
+
+// all lights rewrite their outputs in the next loop() if the scale changes
+void KnxLed::updatePowerScale()
+{
+	uint16_t scale = 1024;
+	if (powerBudget > 0 && powerDemand > powerBudget)
+	{
+		scale = (powerBudget << 10) / powerDemand;
+	}
+	if (scale != powerScale)
+	{
+		powerScale = scale;
+		globalPowerScaleGeneration++;
+	}
+}
+
+// apply all staged channel duties of this light at once
+void KnxLed::commitPwm()
+{
+	commitStagedDuties();
+	commitUpdateDuties();
+}
+
+// apply all staged channel duties of a group of lights at once
+void KnxLed::commitPwm(KnxLed *lights[], uint8_t count)
+{
+	for (uint8_t i = 0; i < count; i++)
+	{
+		lights[i]->commitStagedDuties();
+	}
+	for (uint8_t i = 0; i < count; i++)
+	{
+		lights[i]->commitUpdateDuties();
+	}
+}
+
+// first commit phase: hand the staged duties to the PWM peripheral
+void KnxLed::commitStagedDuties()
+{
+	for (uint8_t ch = 0; ch < 5; ch++)
+	{
+		if (stagedChannels & (1 << ch))
+		{
+#if defined(ESP32)
+			// the new duty is latched by the LEDC peripheral and becomes active at the next PWM period
+			ledc_set_duty_with_hpoint(ESP32_LEDC_MODE(esp32LedCh[ch]), ESP32_LEDC_CHANNEL(esp32LedCh[ch]), pwmDuty(stagedDuty[ch]), pwmDuty(stagedHpoint[ch]));
+#else
+			writePwm(ch, stagedDuty[ch], 0);
+#endif
+		}
+	}
+}
+
+// second commit phase: activate the duties handed over in the first phase
+void KnxLed::commitUpdateDuties()
+{
+#if defined(ESP32)
+	for (uint8_t ch = 0; ch < 5; ch++)
+	{
+		if (stagedChannels & (1 << ch))
+		{
+			ledc_update_duty(ESP32_LEDC_MODE(esp32LedCh[ch]), ESP32_LEDC_CHANNEL(esp32LedCh[ch]));
+		}
+	}
+#endif
+	stagedChannels = 0;
+}
+
+#if defined(KNXLED_STATS)
+knxled_stats_t KnxLed::getStats()
+{
+	knxled_stats_t result = stats;
+	if (stats.ticks > 0)
+	{
+		result.meanTickCycles = sumTickCycles / stats.ticks;
+	}
+	else
+	{
+		result.minTickCycles = 0;
+	}
+	unsigned long duration = millis() - statsStart;
+	if (duration > 0)
+	{
+		result.pwmWritesPerSecond = (uint64_t)stats.pwmWrites * 1000 / duration;
+	}
+	return result;
+}
+
+void KnxLed::resetStats()
+{
+	stats = {0, UINT32_MAX, 0, 0, 0, 0, 0, 0, 0};
+	sumTickCycles = 0;
+	statsStart = millis();
+}
+#endif
+
 bool KnxLed::getSwitchState()
 {
 	return setpointBrightness > 0;
@@ -612,9 +1824,7 @@ uint16_t KnxLed::getTemperature()
 
 rgb_t KnxLed::getRgb()
 {
-	rgb_t _rgb;
-	hsv2rgb(actHsv, _rgb);
-	return _rgb;
+	return actualRgb();
 }
 
 hsv_t KnxLed::getHsv()
@@ -622,11 +1832,86 @@ hsv_t KnxLed::getHsv()
 	return actHsv;
 }
 
+// duty of an output channel as calculated by pwmControl(), before the power budget is applied
+uint16_t KnxLed::getChannelDuty(uint8_t channel)
+{
+	return channel < 5 ? requestedDuty[channel] : 0;
+}
+
+uint32_t KnxLed::getPwmFrequency()
+{
+	return pwmFrequency;
+}
+
+uint8_t KnxLed::getPwmResolution()
+{
+	return pwmResolution;
+}
+
+// true when transitions, relative dimming and effects are finished, so loop() changes nothing without a new command
+bool KnxLed::isSettled()
+{
+	return effect.count == 0 && relDimmCmd.dimMode == IDLE && relTemperatureCmd.dimMode == IDLE && relHueCmd.dimMode == IDLE &&
+		   relSaturationCmd.dimMode == IDLE && actBrightness == setpointBrightness && actTemperature == setpointTemperature &&
+		   actHsv.h == setpointHsv.h && actHsv.s == setpointHsv.s && actHsv.v == targetValue();
+}
+
+// distinct duty steps of the PWM at the current frequency and resolution
+uint32_t KnxLed::getPwmSteps()
+{
+#if defined(ESP32)
+	uint32_t clock = pwmClockEsp32.clock;
+#elif defined(ESP8266)
+	uint32_t clock = pwmClockEsp8266.clock;
+#elif defined(LIBRETINY)
+	uint32_t clock = pwmClockBeken.clock;
+#endif
+	return min<uint32_t>((1UL << pwmResolution) - 1, clock / pwmFrequency);
+}
+
+// record all commands and output duties of this light in the given trace, nullptr stops recording
+void KnxLed::attachTrace(KnxLedTrace *commandTrace)
+{
+	trace = commandTrace;
+}
+
+// internal helper, called at the start of every command from the application but not for the nested calls of other setters.
+// Records the command in the trace, takes its time as start of a synchronised transition and marks the schedule as overridden
+void KnxLed::onCommand(uint8_t type, uint8_t d0, uint8_t d1, uint8_t d2)
+{
+	if (commandDepth > 0)
+	{
+		return;
+	}
+	if (trace != nullptr)
+	{
+		trace->record(type, d0, d1, d2);
+	}
+	// the new setpoints are written to the RTC memory with the next PWM update
+	snapshotTicks = SNAPSHOT_INTERVAL;
+	// switching and learning a scene keep the values of a KnxLedSchedule
+	if (type != TRACE_SWITCH && type != TRACE_LEARN_SCENE)
+	{
+		scheduleOverride = true;
+	}
+	if (syncFade != nullptr)
+	{
+		syncFade->commandTime = syncFade->startPending ? syncFade->pendingStart : getClock();
+		syncFade->startPending = false;
+	}
+}
+
+uint8_t KnxLed::getEffect()
+{
+	return effect.count > 0 ? effectNumber : (uint8_t)EFFECT_NONE;
+}
+
 void KnxLed::returnStatus()
 {
 	if (returnStatusFctn != nullptr)
 	{
 		returnStatusFctn(getSwitchState());
+		KNXLED_STATS_INC(callbacksFired);
 	}
 }
 
@@ -635,6 +1920,7 @@ void KnxLed::returnBrightness()
 	if (returnBrightnessFctn != nullptr)
 	{
 		returnBrightnessFctn(setpointBrightness);
+		KNXLED_STATS_INC(callbacksFired);
 	}
 }
 
@@ -643,6 +1929,7 @@ void KnxLed::returnTemperature()
 	if (returnTemperatureFctn != nullptr)
 	{
 		returnTemperatureFctn(setpointTemperature);
+		KNXLED_STATS_INC(callbacksFired);
 	}
 }
 
@@ -651,12 +1938,12 @@ void KnxLed::returnColors()
 	if (returnColorHsvFctn != nullptr)
 	{
 		returnColorHsvFctn(setpointHsv);
+		KNXLED_STATS_INC(callbacksFired);
 	}
 	if (returnColorRgbFctn != nullptr)
 	{
-		rgb_t _rgb;
-		hsv2rgb(setpointHsv, _rgb);
-		returnColorRgbFctn(_rgb);
+		returnColorRgbFctn(setpointRgb());
+		KNXLED_STATS_INC(callbacksFired);
 	}
 }
 
@@ -697,8 +1984,12 @@ void KnxLed::initSwitchableLight(uint8_t switchPin)
 {
 	lightType = SWITCHABLE;
 	outputPins[0] = switchPin;
-	pinMode(outputPins[0], OUTPUT);
+	if (output == nullptr)
+	{
+		pinMode(outputPins[0], OUTPUT);
+	}
 	initialized = true;
+	restoreSnapshot();
 }
 
 void KnxLed::initDimmableLight(uint8_t ledPin)
@@ -753,32 +2044,293 @@ void KnxLed::initRgbcctLight(uint8_t rPin, uint8_t gPin, uint8_t bPin, uint8_t c
 	initOutputChannels(5);
 }
 
+// Segment of a WS2812 (RGB) or SK6812 (RGBW) strip, the channel values are written to the pixels.
+// outputPins contains the byte of each channel within a pixel.
+void KnxLed::initStripLight(KnxLedStrip &strip, uint16_t firstPixel, uint16_t pixelCount, rgb_t whiteLedRgbEquivalent)
+{
+	output = strip.addSegment(firstPixel, pixelCount);
+	if (output == nullptr)
+	{
+		return;
+	}
+	uint8_t channels = strip.getBytesPerPixel();
+	if (channels == 4)
+	{
+		lightType = RGBW;
+		currentLightMode = MODE_RGB;
+		whiteRgbEquivalent = whiteLedRgbEquivalent;
+	}
+	else
+	{
+		lightType = RGB;
+	}
+	for (uint8_t i = 0; i < channels; i++)
+	{
+		outputPins[i] = strip.channelOffset(i);
+	}
+	initialized = true;
+	restoreSnapshot();
+}
+
+// Picks frequency and resolution of the PWM from constraints, call before the init function. The resolution only
+// changes the PWM, the duties of the light stay 10 bit and are scaled. On ESP8266 and LibreTiny all pins share one
+// frequency and resolution, so the light initialized last wins. Returns false if the constraints can't be met at
+// the same time, the frequency is kept then and getPwmSteps() tells the resulting steps.
+bool KnxLed::configPwm(uint32_t minFrequency, uint8_t minResolution, bool cameraSafe)
+{
+#if defined(ESP32)
+	pwm_config_t config = solvePwm(pwmClockEsp32, minFrequency, minResolution, cameraSafe);
+#elif defined(ESP8266)
+	pwm_config_t config = solvePwm(pwmClockEsp8266, minFrequency, minResolution, cameraSafe);
+#elif defined(LIBRETINY)
+	pwm_config_t config = solvePwm(pwmClockBeken, minFrequency, minResolution, cameraSafe);
+#endif
+	pwmFrequency = config.frequency;
+	pwmResolution = config.resolution;
+	return config.satisfied;
+}
+
+// Highest resolution with all steps at the minimum frequency, then the highest frequency which keeps all steps of
+// this resolution. E.g. ESP8266 with 200 Hz and 10 bit: 12 bit at 244 Hz, ESP32 with 1000 Hz: 14 bit at 4882 Hz.
+pwm_config_t KnxLed::solvePwm(const pwm_clock_t &pwmClock, uint32_t minFrequency, uint8_t minResolution, bool cameraSafe)
+{
+	pwm_config_t config;
+	uint32_t frequency = max<uint32_t>(minFrequency, cameraSafe ? PWM_CAMERA_FREQUENCY : 0);
+	frequency = constrain(frequency, pwmClock.minFrequency, pwmClock.maxFrequency);
+	minResolution = constrain(minResolution, 1, pwmClock.maxResolution);
+
+	// counts of a period with all steps of a resolution
+	uint8_t resolution = pwmClock.maxResolution;
+	uint8_t fullPeriod = pwmClock.fullPeriod ? 1 : 0;
+	while (resolution > 1 && (uint64_t)frequency * ((1UL << resolution) - 1 + fullPeriod) > pwmClock.clock)
+	{
+		resolution--;
+	}
+
+	config.satisfied = resolution >= minResolution;
+	if (config.satisfied)
+	{
+		frequency = max<uint32_t>(frequency, min<uint32_t>(pwmClock.maxFrequency, pwmClock.clock / ((1UL << resolution) - 1 + fullPeriod)));
+	}
+	else if (!pwmClock.fullPeriod)
+	{
+		// the duty range keeps the minimum resolution, the timing of the PWM allows fewer steps
+		resolution = minResolution;
+	}
+	config.frequency = frequency;
+	config.resolution = resolution;
+	config.steps = min<uint32_t>((1UL << resolution) - 1, pwmClock.clock / frequency);
+	return config;
+}
+
+// Drive the channels of the light by a backend instead of the PWM of the SoC, e.g. a KnxLedPca9685.
+// Call before the init function, the pins of the init function are the channels of the backend.
+void KnxLed::configOutput(KnxLedOutput *outputBackend)
+{
+	output = outputBackend;
+}
+
 // internal helper which will be called by init
 void KnxLed::initOutputChannels(uint8_t usedChannels)
 {
-#if defined(ESP32)
-	if (nextEsp32LedChannel <= LEDC_CHANNEL_MAX - usedChannels)
+	// channels of an output backend need no setup
+	if (output == nullptr)
 	{
-		for (uint i = 0; i < usedChannels; i++)
+#if defined(ESP32)
+		if (nextEsp32LedChannel <= LEDC_CHANNEL_MAX - usedChannels)
 		{
-			esp32LedCh[i] = static_cast<ledc_channel_t>(nextEsp32LedChannel++);
-			ledcSetup(esp32LedCh[i], pwmFrequency, pwmResolution);
-			ledcAttachPin(outputPins[i], esp32LedCh[i]);
+			for (uint i = 0; i < usedChannels; i++)
+			{
+				esp32LedCh[i] = nextEsp32LedChannel++;
+				ledcSetup(esp32LedCh[i], pwmFrequency, pwmResolution);
+				ledcAttachPin(outputPins[i], esp32LedCh[i]);
+			}
 		}
-	}
 #else
-	for (uint8_t i = 0; i < usedChannels; i++)
-	{
-		pinMode(outputPins[i], OUTPUT);
-	}
-	analogWriteResolution(pwmResolution);
+		for (uint8_t i = 0; i < usedChannels; i++)
+		{
+			pinMode(outputPins[i], OUTPUT);
+		}
+		analogWriteResolution(pwmResolution);
 	#if defined(ESP8266)
 		analogWriteFreq(pwmFrequency);
 	#else
 		analogWriteFrequency(pwmFrequency);
 	#endif
 #endif
+	}
 	initialized = true;
+	restoreSnapshot();
+}
+
+// internal helper which stores the current state in RTC memory
+void KnxLed::saveSnapshot()
+{
+	if (snapshotSlot >= SNAPSHOT_SLOTS)
+	{
+		return;
+	}
+	snapshotTicks = 0;
+	snapshot_t snapshot;
+	snapshot.version = SNAPSHOT_VERSION;
+	snapshot.lightType = lightType;
+	snapshot.lightMode = currentLightMode;
+	snapshot.actBrightness = actBrightness;
+	snapshot.setpointBrightness = setpointBrightness;
+	snapshot.actHsv = actHsv;
+	snapshot.setpointHsv = setpointHsv;
+	snapshot.actTemperature = actTemperature;
+	snapshot.setpointTemperature = setpointTemperature;
+	snapshot.crc = 0;
+	snapshot.crc = knxLedCrc8((const uint8_t *)&snapshot, sizeof(snapshot_t));
+#if defined(ESP32)
+	rtcSnapshots[snapshotSlot] = snapshot;
+#elif defined(ESP8266)
+	ESP.rtcUserMemoryWrite(SNAPSHOT_RTC_BLOCK + snapshotSlot * sizeof(snapshot_t) / 4, (uint32_t *)&snapshot, sizeof(snapshot_t));
+#endif
+}
+
+// The RTC memory only holds snapshots after a software, watchdog or panic reset, after power on or a reset by the
+// reset pin it contains random data or the state of a light which was switched off meanwhile
+static bool isWarmReset()
+{
+#if defined(ESP32)
+	switch (esp_reset_reason())
+	{
+	case ESP_RST_SW:
+	case ESP_RST_PANIC:
+	case ESP_RST_INT_WDT:
+	case ESP_RST_TASK_WDT:
+	case ESP_RST_WDT:
+		return true;
+	default:
+		return false;
+	}
+#elif defined(ESP8266)
+	uint32_t reason = ESP.getResetInfoPtr()->reason;
+	return reason == REASON_WDT_RST || reason == REASON_EXCEPTION_RST || reason == REASON_SOFT_WDT_RST || reason == REASON_SOFT_RESTART;
+#else
+	return false;
+#endif
+}
+
+// internal helper which will be called by init, restores the state of a warm restart before the first PWM update
+void KnxLed::restoreSnapshot()
+{
+	if (!warmRestart || nextSnapshotSlot >= SNAPSHOT_SLOTS)
+	{
+		return;
+	}
+	snapshotSlot = nextSnapshotSlot++;
+	if (!isWarmReset())
+	{
+		return;
+	}
+
+	snapshot_t snapshot;
+#if defined(ESP32)
+	snapshot = rtcSnapshots[snapshotSlot];
+#elif defined(ESP8266)
+	if (!ESP.rtcUserMemoryRead(SNAPSHOT_RTC_BLOCK + snapshotSlot * sizeof(snapshot_t) / 4, (uint32_t *)&snapshot, sizeof(snapshot_t)))
+	{
+		return;
+	}
+#else
+	return;
+#endif
+	uint8_t crc = snapshot.crc;
+	snapshot.crc = 0;
+	// e.g. a different light setup before the reset
+	if (snapshot.version != SNAPSHOT_VERSION || snapshot.lightType != lightType || crc != knxLedCrc8((const uint8_t *)&snapshot, sizeof(snapshot_t)))
+	{
+		return;
+	}
+	currentLightMode = (LightMode)snapshot.lightMode;
+	actBrightness = snapshot.actBrightness;
+	setpointBrightness = snapshot.setpointBrightness;
+	actHsv = snapshot.actHsv;
+	setpointHsv = snapshot.setpointHsv;
+	actTemperature = snapshot.actTemperature;
+	setpointTemperature = snapshot.setpointTemperature;
+	if (setpointBrightness > 0)
+	{
+		savedBrightness = setpointBrightness;
+	}
+	warmRestored = true;
+	pwmControl();
+}
+
+// CRC-8 (polynomial 0x07)
+uint8_t knxLedCrc8(const uint8_t *data, size_t length)
+{
+	uint8_t crc = 0;
+	for (size_t i = 0; i < length; i++)
+	{
+		crc ^= data[i];
+		for (uint8_t bit = 0; bit < 8; bit++)
+		{
+			crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+		}
+	}
+	return crc;
+}
+
+// internal helpers which convert each state only once, see derived_cache_t
+rgb_t KnxLed::actualRgb()
+{
+	if (!(derived.valid & DERIVED_ACT) || derived.actHsv.h != actHsv.h || derived.actHsv.s != actHsv.s || derived.actHsv.v != actHsv.v)
+	{
+		hsv2rgb(actHsv, derived.actRgb);
+		derived.actWhite = lightType == RGBW ? rgb2White(derived.actRgb) : 0;
+		derived.actHsv = actHsv;
+		derived.valid |= DERIVED_ACT;
+	}
+	return derived.actRgb;
+}
+
+uint8_t KnxLed::actualWhite()
+{
+	actualRgb();
+	return derived.actWhite;
+}
+
+rgb_t KnxLed::setpointRgb()
+{
+	if (!(derived.valid & DERIVED_SETPOINT) || derived.setpointHsv.h != setpointHsv.h || derived.setpointHsv.s != setpointHsv.s || derived.setpointHsv.v != setpointHsv.v)
+	{
+		hsv2rgb(setpointHsv, derived.setpointRgb);
+		derived.setpointHsv = setpointHsv;
+		derived.valid |= DERIVED_SETPOINT;
+	}
+	return derived.setpointRgb;
+}
+
+// duties of the two white channels of TUNABLEWHITE and RGBCT lights at the actual temperature
+void KnxLed::cctDuties(uint8_t brightness, uint16_t duty[2])
+{
+	if ((derived.valid & DERIVED_CCT) && derived.cctBrightness == brightness && derived.cctTemperature == actTemperature)
+	{
+		duty[0] = derived.cctDuty[0];
+		duty[1] = derived.cctDuty[1];
+		return;
+	}
+	duty[0] = 0;
+	duty[1] = 0;
+	if (!isTwTempCh)
+	{
+		duty[0] = curveDuty(constrain(min(2 * (actTemperature - 2700), 3800) / 3800.0 * brightness, 0, 255) + 0.5);
+		duty[1] = curveDuty(constrain(min(2 * (6500 - actTemperature), 3800) / 3800.0 * brightness, 0, 255) + 0.5);
+	}
+	else if (brightness > 0)
+	{
+		duty[0] = curveDuty(brightness, lookupTableTwBulb);
+		duty[1] = constrain((actTemperature - 2700) / 3800.0 * 1023, 0, 1023) + 0.5;
+	}
+	derived.cctBrightness = brightness;
+	derived.cctTemperature = actTemperature;
+	derived.cctDuty[0] = duty[0];
+	derived.cctDuty[1] = duty[1];
+	derived.valid |= DERIVED_CCT;
 }
 
 void KnxLed::rgb2hsv(const rgb_t rgb, hsv_t &hsv)
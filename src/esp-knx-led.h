@@ -16,38 +16,52 @@ extern byte nextEsp32LedChannel; // next available LED channel for ESP32
 #define MIN_BRIGHTNESS 12
 #define MAX_BRIGHTNESS 255
 
+#define EFFECT_FRAME_INTERVAL 20  // ms, effects are rendered with 50 fps
+#define KEYFRAME_KEEP_COLOR 0x80  // keyframe easing flag: only brightness is animated, color/temperature are kept
+
+// Define KNXLED_STATS to collect runtime statistics of fade() and pwmControl(). Without it, no code is generated.
+#if defined(KNXLED_STATS)
+#if defined(ESP32) || defined(ESP8266)
+#define KNXLED_CYCLES() ESP.getCycleCount()
+#else
+#define KNXLED_CYCLES() micros()
+#endif
+#define KNXLED_STATS_INC(field) stats.field++
+#define KNXLED_STATS_SIZE 56 // bytes the statistics add to the instance, allowed on top of KNXLED_MAX_INSTANCE_SIZE
+#else
+#define KNXLED_STATS_INC(field)
+#define KNXLED_STATS_SIZE 0
+#endif
+
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_SLOTS 16        // lights with warm restart support
+#define SNAPSHOT_RTC_BLOCK 64    // ESP8266: first 4 byte block of the RTC user memory used for snapshots
+#define SNAPSHOT_INTERVAL 32     // fade ticks between two snapshots during a transition
+
+#define SCENE_COUNT 64     // scenes per light (DPT 17.001 / 18.001)
+#define SCENE_RGB 0xFE     // scene_t.temperature of an HSV scene
+#define SCENE_EMPTY 0xFF   // scene_t.temperature of a scene which was not learned (= erased flash)
+
+#define DIMM_CURVE_POINTS 17 // support points of a custom dimming curve for the values 0, 16, 32 ... 255
+
+#define PWM_CAMERA_FREQUENCY 20000 // Hz, no banding with short camera exposure times and above the audible range
+
 #define min_f(a, b, c) (fminf(a, fminf(b, c)))
 #define max_f(a, b, c) (fmaxf(a, fmaxf(b, c)))
 
-const uint16_t lookupTable[256] = {
-    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 24, 25, 26, 27, 28, 29, 30, 31, 32, 34, 35, 36, 37, 38, 39, 41, 42, 43, 44, 45,
-    47, 48, 49, 51, 52, 53, 54, 56, 57, 59, 60, 61, 63, 64, 66, 67, 69, 70, 72, 73, 75, 76, 78, 79, 81, 83, 84, 86, 88, 89, 91, 93, 95, 96, 98, 100, 102, 104, 106,
-    108, 109, 111, 113, 115, 117, 120, 122, 124, 126, 128, 130, 132, 135, 137, 139, 142, 144, 146, 149, 151, 154, 156, 159, 161, 164, 166, 169, 172, 174, 177, 180,
-    183, 185, 188, 191, 194, 197, 200, 203, 206, 209, 212, 215, 219, 222, 225, 228, 232, 235, 238, 242, 245, 249, 252, 256, 260, 263, 267, 271, 275, 278, 282, 286,
-    290, 294, 298, 302, 306, 310, 315, 319, 323, 327, 332, 336, 341, 345, 350, 354, 359, 364, 368, 373, 378, 383, 388, 392, 397, 403, 408, 413, 418, 423, 428, 434,
-    439, 445, 450, 456, 461, 467, 472, 478, 484, 490, 496, 502, 508, 514, 520, 526, 532, 538, 545, 551, 557, 564, 570, 577, 584, 590, 597, 604, 611, 618, 625, 632,
-    639, 646, 653, 660, 668, 675, 683, 690, 698, 705, 713, 721, 729, 736, 744, 752, 760, 769, 777, 785, 793, 802, 810, 819, 827, 836, 845, 853, 862, 871, 880, 889,
-    898, 907, 917, 926, 935, 945, 954, 964, 973, 983, 993, 1003, 1013, 1023};
-    
+// gamma corrected 10 bit PWM duty for 8 bit brightness, stored in flash
+extern const uint16_t lookupTable[256];
 // lookup table for E27 LED Bulb with logarithmic dimming curve
-const uint16_t lookupTableTwBulb[256] = {
-    0, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63, 65, 66, 67, 68, 69, 70, 
-    72, 73, 74, 75, 77, 78, 79, 80, 82, 83, 84, 86, 87, 88, 90, 91, 92, 94, 95, 97, 98, 100, 101, 103, 104, 106, 107, 109, 110, 112, 114, 115, 117, 119, 120, 
-    122, 124, 126, 127, 129, 131, 133, 135, 137, 138, 140, 142, 144, 146, 148, 150, 152, 155, 157, 159, 161, 163, 165, 168, 170, 172, 175, 177, 179, 182, 184, 
-    187, 189, 192, 194, 197, 199, 202, 205, 207, 210, 213, 215, 218, 221, 224, 227, 230, 233, 236, 239, 242, 245, 248, 251, 255, 258, 261, 264, 268, 271, 274, 
-    278, 281, 285, 289, 292, 296, 299, 303, 307, 311, 314, 318, 322, 326, 330, 334, 338, 342, 347, 351, 355, 359, 364, 368, 372, 377, 381, 386, 390, 395, 400, 
-    404, 409, 414, 419, 424, 428, 433, 438, 443, 449, 454, 459, 464, 470, 475, 480, 486, 491, 497, 502, 508, 514, 519, 525, 531, 537, 543, 549, 555, 561, 567, 
-    573, 580, 586, 592, 599, 605, 612, 618, 625, 632, 638, 645, 652, 659, 666, 673, 680, 687, 694, 702, 709, 716, 724, 731, 739, 746, 754, 762, 770, 778, 785, 
-    793, 801, 810, 818, 826, 834, 843, 851, 859, 868, 877, 885, 894, 903, 912, 920, 929, 938, 948, 957, 966, 975, 985, 994, 1004, 1013, 1023 };
+extern const uint16_t lookupTableTwBulb[256];
 
 enum __cctMode
 {// CCT mode: normal (2 separate channels), bipolar (2 instead of 3 wires), temperature control channel (CH1=brightness, CH2=temperature)
     NORMAL,
-    BIPOLAR,
+    BIPOLAR,      // ESP32 only, the channels need opposite phases (LEDC hpoint)
     TEMP_CHANNEL
 };
 
-enum __dimMode
+enum __dimMode : uint8_t
 {    
     STOP=0,
     DOWN=1,
@@ -145,16 +159,184 @@ typedef struct __rgb
     }
 } rgb_t;
 
+enum __easing
+{// easing curve of the transition from the previous keyframe
+    EASE_LINEAR,
+    EASE_IN,
+    EASE_OUT,
+    EASE_IN_OUT
+};
+
+enum __colorInterpolation
+{// path of hue and saturation transitions
+    INTERPOLATE_HSV,    // step hue and saturation around the color wheel
+    INTERPOLATE_LINEAR  // straight line between the colors in linear light (PWM duty) space
+};
+
+enum __dimmCurve
+{// mapping of the 8 bit channel values to PWM duty
+    CURVE_DEFAULT,     // built-in lookup tables
+    CURVE_LINEAR,
+    CURVE_CIE_LSTAR,   // CIE 1976 lightness, perceived brightness changes evenly
+    CURVE_LOGARITHMIC  // DALI curve, 0.1% .. 100% in 254 steps
+};
+
+typedef struct __keyframe
+{
+    uint16_t frames;      // transition time from the previous keyframe in frames (see EFFECT_FRAME_INTERVAL)
+    uint8_t easing;       // __easing, optionally combined with KEYFRAME_KEEP_COLOR
+    uint8_t h;            // hue (ignored for temperature keyframes)
+    uint8_t s;            // saturation (ignored for temperature keyframes)
+    uint8_t v;            // brightness
+    uint16_t temperature; // 0 = HSV keyframe, otherwise color temperature in K
+} keyframe_t;
+
+typedef struct __effect
+{
+    const keyframe_t *keyframes; // keyframe sequence, should be stored in PROGMEM
+    uint8_t count;
+    bool repeat;
+} effect_t;
+
+typedef struct __scene
+{
+    uint8_t v;           // brightness
+    uint8_t h;           // hue (HSV scene only)
+    uint8_t s;           // saturation (HSV scene only)
+    uint8_t temperature; // (K - 2700) / 20, SCENE_RGB or SCENE_EMPTY
+} scene_t;
+
+typedef struct __sceneTable
+{
+    scene_t scene[SCENE_COUNT];
+    uint64_t changed;    // bitmask of scenes which were changed since they were persisted
+} scene_table_t;
+
+typedef struct __colorFade
+{
+    uint16_t from[3]; // linear RGB at full brightness
+    uint16_t to[3];
+    uint8_t h;        // target hue and saturation
+    uint8_t s;
+    uint8_t step;
+    uint8_t steps;    // 0 = no transition running
+} color_fade_t;
+
+#define DERIVED_ACT 0x01      // derived_cache_t.valid flags
+#define DERIVED_SETPOINT 0x02
+#define DERIVED_CCT 0x04
+
+// values derived from the light state, each is only calculated again when its input changed
+typedef struct __derivedCache
+{
+    hsv_t actHsv;            // input of actRgb and actWhite
+    rgb_t actRgb;
+    uint8_t actWhite;        // white channel of RGBW lights
+    hsv_t setpointHsv;       // input of setpointRgb
+    rgb_t setpointRgb;
+    uint8_t cctBrightness;   // input of cctDuty together with cctTemperature
+    uint16_t cctTemperature;
+    uint16_t cctDuty[2];     // white channels of TUNABLEWHITE and RGBCT lights
+    uint8_t valid;
+} derived_cache_t;
+
+typedef struct __syncValues
+{
+    uint16_t temperature;
+    uint8_t brightness;
+    hsv_t hsv;
+} sync_values_t;
+
+typedef struct __syncFade
+{
+    uint32_t commandTime;  // clock of the last command, start of the transition it causes
+    uint32_t start;        // clock of the start of the current transition
+    uint32_t pendingStart; // start time for the next command, see setTransitionStart()
+    sync_values_t from;
+    sync_values_t to;
+    uint16_t duration;     // ms
+    bool startPending;
+} sync_fade_t;
+
+typedef struct __snapshot
+{// state of a light which survives a warm restart, stored in RTC memory
+    uint8_t version;
+    uint8_t lightType;
+    uint8_t lightMode;
+    uint8_t crc;
+    uint8_t actBrightness;
+    uint8_t setpointBrightness;
+    hsv_t actHsv;
+    hsv_t setpointHsv;
+    uint16_t actTemperature;
+    uint16_t setpointTemperature;
+} snapshot_t;
+
+#if defined(KNXLED_STATS)
+typedef struct __knxLedStats
+{
+    uint32_t ticks;               // fade() runs
+    uint32_t minTickCycles;       // CPU cycles (micros() on libretiny) of one loop() including fade() and pwmControl()
+    uint32_t maxTickCycles;
+    uint32_t meanTickCycles;
+    uint32_t pwmWrites;           // written output channels
+    uint32_t pwmWritesPerSecond;
+    uint32_t callbacksFired;      // feedback callbacks which were called
+    uint32_t feedbackSuppressed;  // feedback skipped during relative dimming
+    uint32_t maxLoopGap;          // longest time between two loop() calls in µs
+} knxled_stats_t;
+#endif
+
+uint8_t knxLedCrc8(const uint8_t *data, size_t length);
+
+// clock model of a PWM peripheral, see KnxLed::solvePwm()
+typedef struct __pwmClock
+{
+    uint32_t clock;        // Hz of the PWM counter
+    uint32_t minFrequency; // Hz
+    uint32_t maxFrequency; // Hz
+    uint8_t maxResolution; // bits
+    bool fullPeriod;       // the period is always 2^resolution counts (ESP32 LEDC), otherwise clock / frequency counts
+} pwm_clock_t;
+
+extern const pwm_clock_t pwmClockEsp32;
+extern const pwm_clock_t pwmClockEsp8266;
+extern const pwm_clock_t pwmClockBeken;
+
+typedef struct __pwmConfig
+{
+    uint32_t frequency; // Hz
+    uint8_t resolution; // bits
+    uint32_t steps;     // effective number of duty steps at this frequency
+    bool satisfied;     // false if the minimum frequency and resolution are not possible at the same time
+} pwm_config_t;
+
 typedef void callbackBool(bool);
 typedef void callbackUint8(uint8_t);
 typedef void callbackUint16(uint16_t);
 typedef void callbackRgb(rgb_t);
 typedef void callbackHsv(hsv_t);
+typedef uint32_t clockSource();
+
+class KnxLedTrace;
+class KnxLedStrip;
+class KnxLedBatch;
+class KnxLedOutput;
 
 class KnxLed
 {
+    friend class KnxLedStorage;
+    friend class KnxLedTrace;
+    friend class KnxLedBatch;
+    friend class KnxLedSchedule;
+
 public:
-    enum LightTypes
+    KnxLed();
+    ~KnxLed();
+    KnxLed(const KnxLed &) = delete; // owns its allocated state
+    KnxLed &operator=(const KnxLed &) = delete;
+
+    enum LightTypes : uint8_t
     {
         SWITCHABLE,
         DIMMABLE,
@@ -164,23 +346,54 @@ public:
         RGBCT
     };
 
-    enum LightMode
+    enum LightMode : uint8_t
     {
         MODE_CCT,
         MODE_RGB
     };
 
+    enum Effects
+    {
+        EFFECT_NONE,
+        EFFECT_COLORLOOP,
+        EFFECT_SUNRISE,
+        EFFECT_SUNSET,
+        EFFECT_BREATHING,
+        EFFECT_CUSTOM = 255
+    };
+
     void initSwitchableLight(uint8_t switchPin);
     void initDimmableLight(uint8_t ledPin);
     void initTunableWhiteLight(uint8_t cwPin, uint8_t wwPin, __cctMode cctMode);
     void initRgbLight(uint8_t rPin, uint8_t gPin, uint8_t bPin);
     void initRgbwLight(uint8_t rPin, uint8_t gPin, uint8_t bPin, uint8_t wPin, rgb_t whiteLedRgbEquivalent);
     void initRgbcctLight(uint8_t rPin, uint8_t gPin, uint8_t bPin, uint8_t cwPin, uint8_t wwPin, __cctMode cctMode);
+    void configOutput(KnxLedOutput *outputBackend);
+    bool configPwm(uint32_t minFrequency, uint8_t minResolution = 10, bool cameraSafe = false);
+    static pwm_config_t solvePwm(const pwm_clock_t &pwmClock, uint32_t minFrequency, uint8_t minResolution, bool cameraSafe = false);
+    void initStripLight(KnxLedStrip &strip, uint16_t firstPixel, uint16_t pixelCount, rgb_t whiteLedRgbEquivalent = {255, 255, 255});
 
     void configDefaultBrightness(uint8_t brightness);
     void configDefaultTemperature(uint16_t temperature);
     void configDefaultHsv(hsv_t hsv);
     void configDimmSpeed(uint8_t dimmSetSpeed);
+    void configLatchedUpdate(bool latched, bool autoCommit = true);
+    void configColorInterpolation(__colorInterpolation interpolation);
+    void configDimmCurve(__dimmCurve curve);
+    void configDimmCurve(const uint16_t points[DIMM_CURVE_POINTS]);
+    void configDimmEasing(__easing easing);
+    void configWarmRestart(bool enable);
+    void configChannelCurrent(uint8_t channel, uint16_t current);
+
+    static void configPowerBudget(uint32_t maxCurrent);
+    static uint32_t getCurrentDemand();
+
+    void configSyncedTransition(uint16_t duration);
+    void setTransitionStart(uint32_t startTime);
+    static void configClockSource(clockSource *source);
+    static void setClock(uint32_t time);
+    static bool setClockDpt19(const uint8_t *dpt19);
+    static uint32_t getClock();
 
     void registerStatusCallback(callbackBool *fctn);
     void registerBrightnessCallback(callbackUint8 *fctn);
@@ -200,33 +413,116 @@ public:
     void setRelHueCmd(dpt3_t hueCmd);
     void setRelSaturationCmd(dpt3_t saturationCmd);
 
+    void setEffect(uint8_t effectNumber);
+    void playEffect(const effect_t &customEffect);
+    void stopEffect();
+
+    void setScene(uint8_t sceneCmd);
+    void recallScene(uint8_t sceneNumber);
+    void learnScene(uint8_t sceneNumber);
+    bool getSceneData(uint8_t sceneNumber, scene_t &scene);
+    void setSceneData(uint8_t sceneNumber, scene_t scene);
+
     void sendStatusUpdate();
 
+    void commitPwm();
+    static void commitPwm(KnxLed *lights[], uint8_t count);
+
     bool getSwitchState();
     uint8_t getBrightness();
     uint16_t getTemperature();
     rgb_t getRgb();
     hsv_t getHsv();
+    uint8_t getEffect();
+    uint16_t getChannelDuty(uint8_t channel);
+    uint32_t getPwmFrequency();
+    uint8_t getPwmResolution();
+    uint32_t getPwmSteps();
+    bool isSettled();
+
+    void attachTrace(KnxLedTrace *commandTrace);
 
     void loop();
 
+#if defined(KNXLED_STATS)
+    knxled_stats_t getStats();
+    void resetStats();
+#endif
+
 private:
-    bool initialized = false;
-    LightTypes lightType;
-    byte outputPins[5];
-    LightMode currentLightMode = MODE_CCT;
-    unsigned int pwmResolution = 10;  // 2^10 = 1024
+    // members are ordered by alignment to avoid padding, see KNXLED_MAX_INSTANCE_SIZE
     // Default is 1023
     // All 1022 PWM steps are available at 977Hz, 488Hz, 325Hz, 244Hz, 195Hz, 162Hz, 139Hz, 122Hz, 108Hz, 97Hz, 88Hz, 81Hz, 75Hz, etc.
     // Calculation = truncate(1/(1E-6 * 1023)) for the PWM frequencies with all (or most) discrete PWM steps. (master)
+    // configPwm() picks frequency and resolution from constraints instead, see solvePwm()
 #if defined(ESP32)
-    unsigned int pwmFrequency = 5000; // 5kHz
-    ledc_channel_t esp32LedCh[5];
+    uint32_t pwmFrequency = 5000; // 5kHz
 #elif defined(ESP8266)
-    unsigned int pwmFrequency = 2000;  // 2kHz bei Library >=3.0.0, 50Hz bei Library 2.6.3
+    uint32_t pwmFrequency = 2000;  // 2kHz bei Library >=3.0.0, 50Hz bei Library 2.6.3
 #elif defined(LIBRETINY)
-    unsigned int pwmFrequency = 1000;  // 1kHz
+    uint32_t pwmFrequency = 1000;  // 1kHz
+#endif
+
+    callbackBool *returnStatusFctn = nullptr;
+    callbackUint8 *returnBrightnessFctn = nullptr;
+    callbackUint16 *returnTemperatureFctn = nullptr;
+    callbackRgb *returnColorRgbFctn = nullptr;
+    callbackHsv *returnColorHsvFctn = nullptr;
+
+    KnxLedTrace *trace = nullptr;
+    scene_table_t *scenes = nullptr;       // allocated when the first scene is learned
+    color_fade_t *colorFade = nullptr;     // only allocated for INTERPOLATE_LINEAR
+    uint16_t *dimmCurve = nullptr;         // baked PWM duties of a configured curve, nullptr = CURVE_DEFAULT
+    KnxLedOutput *output = nullptr;        // output backend instead of the PWM of the SoC, e.g. strip pixels
+    sync_fade_t *syncFade = nullptr;       // only allocated for synchronised transitions
+
+    effect_t effect = {nullptr, 0, false}; // running effect, effect.count == 0 if none
+    unsigned long effectLastFrame = 0;     // clock source time of the last rendered frame
+
+    uint16_t defaultTemperature = 3500;
+    uint16_t setpointTemperature = defaultTemperature;
+    uint16_t actTemperature = defaultTemperature;
+
+    uint16_t stagedDuty[5] = {0};          // duties of the latched update
+#if defined(ESP32)
+    uint16_t stagedHpoint[5] = {0};
+#endif
+    uint16_t channelCurrent[5] = {0};      // current of each channel at full duty in mA, 0 = not part of the power budget
+    uint16_t requestedDuty[5] = {0};       // last duty written by pwmControl(), before power budget scaling
+    derived_cache_t derived = {};          // valid = 0 until the first conversion
+
+    uint16_t effectFrame = 0;              // frames since the start of the current keyframe
+    keyframe_t effectFrom = {};            // light state at the start of the current keyframe
+    keyframe_t effectTo = {};              // current keyframe, resolved for this light type
+
+    LightTypes lightType = SWITCHABLE;
+    LightMode currentLightMode = MODE_CCT;
+    byte outputPins[5] = {0};
+#if defined(ESP32)
+    uint8_t esp32LedCh[5] = {0};
 #endif
+    uint8_t pwmResolution = 10;  // 2^10 = 1024
+
+    bool initialized : 1;
+    bool isTwBipolar : 1;        // Tunable White with 2-Wires and different polarity for each channel
+    bool isTwTempCh : 1;         // Tunable White with brightness channel and temperature channel
+    bool warmRestart : 1;
+    bool latchedUpdate : 1;      // stage all channel duties and commit them together
+    bool latchedAutoCommit : 1;  // commit at the end of each pwmControl(), otherwise commitPwm() must be called
+    uint8_t dimmEasing : 2;      // __easing of brightness transitions
+    bool rewriteOutputs : 1;     // write all channels even if the duty is unchanged, e.g. after a power scale change
+    bool scheduleOverride : 1;   // command from the application since the last KnxLedSchedule::loop()
+    bool warmRestored : 1;       // state was restored from the snapshot of a warm restart
+
+    uint8_t stagedChannels = 0;       // bitmask of channels with a staged duty
+#if defined(ESP32)
+    uint8_t shiftedChannels = 0;      // bitmask of channels whose duty was last written with a phase shift (hpoint)
+#endif
+    uint8_t powerScaleGeneration = 0; // power scale the current duties were written with
+    uint8_t snapshotSlot = 0xFF;      // RTC memory slot, 0xFF = no warm restart
+    uint8_t snapshotTicks = 0;        // fade ticks since the last snapshot
+    uint8_t commandDepth = 0;         // > 0 while a setter calls other setters
+
     uint8_t dimmSpeed = 6;
     uint8_t dimmCount = 0;
 
@@ -234,41 +530,90 @@ private:
     uint8_t savedBrightness = 0;
     uint8_t setpointBrightness = 0;
     uint8_t actBrightness = 0;
+    uint8_t easeFrom = 0;             // brightness transition with easing: start, target and linear progress
+    uint8_t easeTarget = 0;
+    uint8_t easeLinear = 0;
 
-    uint16_t defaultTemperature = 3500;
-    uint16_t setpointTemperature = defaultTemperature;
-    uint16_t actTemperature = defaultTemperature;
-
-    hsv_t defaultHsv;
-    hsv_t savedHsv;
-    hsv_t setpointHsv;
-    hsv_t actHsv;    
+    hsv_t defaultHsv = {0, 0, 0};
+    hsv_t savedHsv = {0, 0, 0};
+    hsv_t setpointHsv = {0, 0, 0};
+    hsv_t actHsv = {0, 0, 0};
 
-    bool isTwBipolar = false;     // Tunable White with 2-Wires and different polarity for each channel
-    bool isTwTempCh = false;      // Tunable White with brightness channel and temperature channel
-    rgb_t whiteRgbEquivalent;     // Color temperature of white LED for RGBW
+    rgb_t whiteRgbEquivalent = {255, 255, 255}; // Color temperature of white LED for RGBW
 
     dpt3_t relDimmCmd;
     dpt3_t relTemperatureCmd;
     dpt3_t relHueCmd;
     dpt3_t relSaturationCmd;
+    uint8_t relDimmSteps = 0;         // remaining dimming steps of a DPT 3.007 interval, 0 = until STOP
+    uint8_t relTemperatureSteps = 0;
+    uint8_t relHueSteps = 0;
+    uint8_t relSaturationSteps = 0;
+
+    uint8_t effectNumber = EFFECT_NONE;
+    uint8_t effectKeyframe = 0;            // index of the keyframe which is faded to
+
+#if defined(KNXLED_STATS)
+    knxled_stats_t stats = {0, UINT32_MAX, 0, 0, 0, 0, 0, 0, 0};
+    uint64_t sumTickCycles = 0;
+    unsigned long statsStart = 0;     // millis()
+    unsigned long lastLoop = 0;       // micros()
+#endif
 
-    callbackBool *returnStatusFctn;
-    callbackUint8 *returnBrightnessFctn;
-    callbackUint16 *returnTemperatureFctn;
-    callbackRgb *returnColorRgbFctn;
-    callbackHsv *returnColorHsvFctn;
+    static uint64_t powerBudget;      // mA * 1023, 0 = no limit
+    static uint64_t powerDemand;      // running sum of channelCurrent * requestedDuty over all lights
+    static uint16_t powerScale;       // 1024 = 100%
+    static uint8_t globalPowerScaleGeneration;
+    static clockSource *clockFctn;
+    static uint32_t clockOffset;      // added to the clock source to get the shared time
+    static KnxLedBatch *renderBatch;  // batch which renders the outputs of the light whose loop() it runs
 
     void initOutputChannels(uint8_t usedChannels);
+    void saveSnapshot();
+    void restoreSnapshot();
+    uint64_t getChangedScenes();
+    void clearChangedScenes();
+    void onCommand(uint8_t type, uint8_t d0, uint8_t d1 = 0, uint8_t d2 = 0);
+    uint8_t dpt3StepCount(dpt3_t cmd, uint16_t range);
     void fade();
+    bool fadeColorLinear();
+    bool fadeStep();
+    bool fadeSynced();
+    bool isRelativeDimming();
+    void fadeBrightness();
+    uint16_t curveDuty(uint8_t value, const uint16_t *defaultTable = lookupTable);
+    uint8_t curveValue(uint16_t duty);
+    void startKeyframe();
+    void renderEffect(uint16_t frames);
+    void applyEffectValues(uint8_t h, uint8_t s, uint8_t v, uint16_t temperature);
+    void updateOutputs();
     void pwmControl();
-    void ledAnalogWrite(byte channel, uint16_t duty);
+    void ledAnalogWrite(byte channel, uint16_t duty, uint16_t hpoint = 0);
+    void updatePowerDemand(byte channel, uint16_t duty);
+    static void updatePowerScale();
+    uint32_t pwmDuty(uint16_t duty);
+    void writePwm(byte channel, uint16_t duty, uint16_t hpoint);
+    uint8_t targetValue();
+    void keepRgbwLevel();
+    void followSchedule(uint16_t temperature, uint8_t brightness);
+    void commitStagedDuties();
+    void commitUpdateDuties();
     void returnStatus();
     void returnBrightness();
     void returnTemperature();
     void returnColors();
+    rgb_t actualRgb();
+    uint8_t actualWhite();
+    rgb_t setpointRgb();
+    void cctDuties(uint8_t brightness, uint16_t duty[2]);
     void rgb2hsv(const rgb_t rgb, hsv_t &hsv);
     void hsv2rgb(const hsv_t hsv, rgb_t &rgb);
     void kelvin2rgb(const uint16_t temperature, const uint8_t brightness, rgb_t &rgb);
     uint8_t rgb2White(const rgb_t rgb);
-};
\ No newline at end of file
+};
+
+// keep the RAM usage low enough for 16+ instances on an ESP8266 (16 * 208 bytes = 3.3 kB)
+#ifndef KNXLED_MAX_INSTANCE_SIZE
+#define KNXLED_MAX_INSTANCE_SIZE 208
+#endif
+static_assert(sizeof(KnxLed) <= KNXLED_MAX_INSTANCE_SIZE + KNXLED_STATS_SIZE, "KnxLed instance size exceeds its budget");
\ No newline at end of file
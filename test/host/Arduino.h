@@ -0,0 +1,163 @@
+#pragma once
+
+// Fake Arduino core for host builds of the library (ESP32 or ESP8266 defined on the command line), see test/Makefile.
+// Only the functions used by the library and the bench are provided. Outputs are recorded instead of driven.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+typedef uint8_t byte;
+typedef unsigned int uint;
+typedef bool boolean;
+
+using std::max;
+using std::min;
+
+#define PROGMEM
+#define IRAM_ATTR
+#define F_CPU 80000000L
+
+#define OUTPUT 1
+#define HIGH 1
+#define LOW 0
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define lowByte(w) ((uint8_t)((w) & 0xff))
+#define highByte(w) ((uint8_t)((w) >> 8))
+
+inline uint16_t pgm_read_word(const void *address)
+{
+    return *(const uint16_t *)address;
+}
+
+inline void *memcpy_P(void *dest, const void *src, size_t length)
+{
+    return memcpy(dest, src, length);
+}
+
+// Time runs with the host clock until a test sets a simulated time, which then only changes with hostSetMicros() and
+// hostAdvanceMillis()
+unsigned long millis();
+unsigned long micros();
+void hostSetMicros(uint64_t time);
+void hostAdvanceMillis(uint32_t ms);
+
+inline void delay(unsigned long) {}
+inline void delayMicroseconds(unsigned int) {}
+inline void yield() {}
+inline void interrupts() {}
+inline void noInterrupts() {}
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+// last written value of each pin and the number of analogWrite() calls
+#define HOST_PINS 40
+extern int hostPinValue[HOST_PINS];
+extern uint32_t hostAnalogWrites;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+void analogWrite(uint8_t pin, int value);
+inline void analogWriteResolution(int) {}
+inline void analogWriteFreq(uint32_t) {}
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c);
+    size_t print(const char *text);
+    size_t println(const char *text);
+    size_t println();
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class HardwareSerial : public Print
+{
+public:
+    void begin(unsigned long) {}
+};
+extern HardwareSerial Serial;
+
+#define HOST_RTC_MEMORY 512   // bytes of the ESP8266 RTC user memory
+#define HOST_FLASH_SIZE 65536 // bytes of the ESP8266 flash, sector 0 is at offset 0
+
+struct rst_info;
+
+class EspClass
+{
+public:
+    uint32_t getCycleCount(); // host clock in cycles of getCpuFreqMHz()
+    uint8_t getCpuFreqMHz() { return 80; }
+    bool flashRead(uint32_t offset, uint32_t *data, size_t size);
+    bool flashWrite(uint32_t offset, const uint32_t *data, size_t size);
+    bool flashEraseSector(uint32_t sector);
+    bool rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size);
+    bool rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size);
+    struct rst_info *getResetInfoPtr();
+};
+extern EspClass ESP;
+extern uint8_t hostFlash[HOST_FLASH_SIZE];
+extern uint8_t hostRtcMemory[HOST_RTC_MEMORY]; // RTC user memory of the ESP8266, not cleared by a simulated reset
+extern uint32_t hostRtcWrites;
+extern uint32_t hostResetReason; // esp_reset_reason_t on the ESP32, rst_reason on the ESP8266, power on by default
+
+#if defined(ESP8266)
+// GPIO set and clear registers of the bitbang strip output
+extern volatile uint32_t hostGpioSet;
+extern volatile uint32_t hostGpioClear;
+#define GPOS hostGpioSet
+#define GPOC hostGpioClear
+#endif
+
+#if defined(ESP32)
+// RTC slow memory is a section which the tests can modify like hostRtcMemory, it's kept between simulated resets
+#define RTC_NOINIT_ATTR __attribute__((section("host_rtc_noinit")))
+extern uint8_t __start_host_rtc_noinit[];
+
+typedef enum
+{
+    ESP_RST_UNKNOWN,
+    ESP_RST_POWERON,
+    ESP_RST_EXT,
+    ESP_RST_SW,
+    ESP_RST_PANIC,
+    ESP_RST_INT_WDT,
+    ESP_RST_TASK_WDT,
+    ESP_RST_WDT,
+    ESP_RST_DEEPSLEEP,
+    ESP_RST_BROWNOUT,
+    ESP_RST_SDIO
+} esp_reset_reason_t;
+esp_reset_reason_t esp_reset_reason();
+
+// duty of each LEDC channel
+extern uint32_t hostLedcDuty[16];
+inline void ledcSetup(uint8_t, uint32_t, uint8_t) {}
+inline void ledcAttachPin(uint8_t, uint8_t) {}
+void ledcWrite(uint8_t channel, uint32_t duty);
+
+// the host has no tasks, xTaskCreate() fails and code with a task falls back to its synchronous path
+typedef void *TaskHandle_t;
+#define pdTRUE 1
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xFFFFFFFF
+inline int xTaskCreate(void (*)(void *), const char *, uint32_t, void *, int, TaskHandle_t *) { return pdFAIL; }
+inline void vTaskDelete(TaskHandle_t) {}
+inline void xTaskNotifyGive(TaskHandle_t) {}
+inline uint32_t ulTaskNotifyTake(int, uint32_t) { return 0; }
+typedef void *SemaphoreHandle_t;
+inline SemaphoreHandle_t xSemaphoreCreateBinary() { return nullptr; }
+inline int xSemaphoreGive(SemaphoreHandle_t) { return pdTRUE; }
+inline int xSemaphoreTake(SemaphoreHandle_t, uint32_t) { return pdTRUE; }
+inline void vSemaphoreDelete(SemaphoreHandle_t) {}
+#endif
@@ -0,0 +1,11 @@
+#include <Arduino.h>
+
+// runs bench/bench.cpp once on the host, the exit code is non-zero if a check failed
+void setup();
+extern uint16_t benchFailures;
+
+int main()
+{
+	setup();
+	return benchFailures > 0 ? 1 : 0;
+}
@@ -0,0 +1,30 @@
+#include "check.h"
+
+uint32_t checkCount = 0;
+uint32_t checkFailures = 0;
+
+void checkTrue(bool condition, const char *text, const char *file, int line)
+{
+	checkCount++;
+	if (!condition)
+	{
+		checkFailures++;
+		printf("FAIL %s:%d: %s\n", file, line, text);
+	}
+}
+
+void checkEqual(long long actual, long long expected, const char *text, const char *file, int line)
+{
+	checkCount++;
+	if (actual != expected)
+	{
+		checkFailures++;
+		printf("FAIL %s:%d: %s is %lld, expected %lld\n", file, line, text, actual, expected);
+	}
+}
+
+int checkResult(const char *name)
+{
+	printf("%s: %u checks, %u failed\n", name, checkCount, checkFailures);
+	return checkFailures > 0 ? 1 : 0;
+}
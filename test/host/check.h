@@ -0,0 +1,14 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Assertions of the host tests. A failed check prints its location and values, checkResult() is the exit code.
+extern uint32_t checkCount;
+extern uint32_t checkFailures;
+
+#define CHECK(condition) checkTrue((condition), #condition, __FILE__, __LINE__)
+#define CHECK_EQUAL(actual, expected) checkEqual((long long)(actual), (long long)(expected), #actual, __FILE__, __LINE__)
+
+void checkTrue(bool condition, const char *text, const char *file, int line);
+void checkEqual(long long actual, long long expected, const char *text, const char *file, int line);
+int checkResult(const char *name);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <Arduino.h>
+
+typedef enum
+{
+    LEDC_HIGH_SPEED_MODE,
+    LEDC_LOW_SPEED_MODE
+} ledc_mode_t;
+
+typedef enum
+{
+    LEDC_CHANNEL_0,
+    LEDC_CHANNEL_MAX = 8
+} ledc_channel_t;
+
+// phase shift of each LEDC channel (same numbering as ledcWrite()), the duty is in hostLedcDuty
+extern uint32_t hostLedcHpoint[16];
+
+int ledc_set_duty_with_hpoint(ledc_mode_t mode, ledc_channel_t channel, uint32_t duty, uint32_t hpoint);
+int ledc_update_duty(ledc_mode_t mode, ledc_channel_t channel);
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Arduino.h>
+
+// RMT transmitter, show() of KnxLedStripRmt only counts the sent bytes
+typedef int esp_err_t;
+#define ESP_OK 0
+typedef int gpio_num_t;
+
+typedef enum
+{
+    RMT_CHANNEL_0,
+    RMT_CHANNEL_1,
+    RMT_CHANNEL_MAX = 8
+} rmt_channel_t;
+
+typedef struct
+{
+    union
+    {
+        struct
+        {
+            uint32_t duration0 : 15;
+            uint32_t level0 : 1;
+            uint32_t duration1 : 15;
+            uint32_t level1 : 1;
+        };
+        uint32_t val;
+    };
+} rmt_item32_t;
+
+typedef struct
+{
+    int rmt_mode;
+    rmt_channel_t channel;
+    gpio_num_t gpio_num;
+    uint8_t clk_div;
+    uint8_t mem_block_num;
+} rmt_config_t;
+
+#define RMT_DEFAULT_CONFIG_TX(gpio, ch) {0, ch, gpio, 80, 1}
+
+typedef void (*sample_to_rmt_t)(const void *src, rmt_item32_t *dest, size_t src_size, size_t wanted_num, size_t *translated_size, size_t *item_num);
+
+extern uint32_t hostRmtBytes;
+
+inline esp_err_t rmt_config(const rmt_config_t *) { return ESP_OK; }
+inline esp_err_t rmt_driver_install(rmt_channel_t, size_t, int) { return ESP_OK; }
+inline esp_err_t rmt_driver_uninstall(rmt_channel_t) { return ESP_OK; }
+inline esp_err_t rmt_translator_init(rmt_channel_t, sample_to_rmt_t) { return ESP_OK; }
+inline esp_err_t rmt_write_sample(rmt_channel_t, const uint8_t *, size_t size, bool)
+{
+    hostRmtBytes += size;
+    return ESP_OK;
+}
+inline esp_err_t rmt_wait_tx_done(rmt_channel_t, uint32_t) { return ESP_OK; }
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <Arduino.h>
+
+// a single data partition in RAM, hostPartition.size is 0 (not found) until a test sets it
+typedef struct
+{
+    uint32_t size;
+} esp_partition_t;
+
+#define ESP_OK 0
+#define ESP_PARTITION_TYPE_DATA 1
+#define ESP_PARTITION_SUBTYPE_ANY 0xFF
+
+extern esp_partition_t hostPartition;
+
+const esp_partition_t *esp_partition_find_first(int type, int subtype, const char *label);
+int esp_partition_read(const esp_partition_t *partition, size_t offset, void *data, size_t size);
+int esp_partition_write(const esp_partition_t *partition, size_t offset, const void *data, size_t size);
+int esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size);
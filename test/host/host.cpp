@@ -0,0 +1,309 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include <chrono>
+#if defined(ESP32)
+#include "driver/ledc.h"
+#include "driver/rmt.h"
+#include "esp_partition.h"
+#elif defined(ESP8266)
+#include "user_interface.h"
+#endif
+
+// state of the fake Arduino core, see Arduino.h
+
+static bool simulatedTime = false;
+static uint64_t simulatedMicros = 0;
+
+static uint64_t hostNanos()
+{
+	static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static uint64_t hostMicros()
+{
+	return hostNanos() / 1000;
+}
+
+unsigned long millis()
+{
+	return (simulatedTime ? simulatedMicros : hostMicros()) / 1000;
+}
+
+unsigned long micros()
+{
+	return simulatedTime ? simulatedMicros : hostMicros();
+}
+
+void hostSetMicros(uint64_t time)
+{
+	simulatedTime = true;
+	simulatedMicros = time;
+}
+
+void hostAdvanceMillis(uint32_t ms)
+{
+	hostSetMicros(micros() + ms * 1000ULL);
+}
+
+// xorshift, so random() gives the same sequence on every host
+static uint32_t randomState = 1;
+
+long random(long howbig)
+{
+	if (howbig <= 0)
+	{
+		return 0;
+	}
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+	return randomState % howbig;
+}
+
+long random(long howsmall, long howbig)
+{
+	return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed)
+{
+	randomState = seed != 0 ? seed : 1;
+}
+
+int hostPinValue[HOST_PINS];
+uint32_t hostAnalogWrites = 0;
+
+void pinMode(uint8_t, uint8_t)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+	if (pin < HOST_PINS)
+	{
+		hostPinValue[pin] = value;
+	}
+}
+
+void analogWrite(uint8_t pin, int value)
+{
+	if (pin < HOST_PINS)
+	{
+		hostPinValue[pin] = value;
+	}
+	hostAnalogWrites++;
+}
+
+size_t Print::write(uint8_t c)
+{
+	return fputc(c, stdout) == EOF ? 0 : 1;
+}
+
+size_t Print::print(const char *text)
+{
+	size_t length = 0;
+	while (*text)
+	{
+		length += write(*text++);
+	}
+	return length;
+}
+
+size_t Print::println(const char *text)
+{
+	return print(text) + println();
+}
+
+size_t Print::println()
+{
+	return write('\n');
+}
+
+size_t Print::printf(const char *format, ...)
+{
+	char buffer[256];
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	if (length < 0)
+	{
+		return 0;
+	}
+	if ((size_t)length >= sizeof(buffer))
+	{
+		char *large = new char[length + 1];
+		va_start(args, format);
+		vsnprintf(large, length + 1, format, args);
+		va_end(args);
+		size_t written = print(large);
+		delete[] large;
+		return written;
+	}
+	return print(buffer);
+}
+
+HardwareSerial Serial;
+TwoWire Wire;
+EspClass ESP;
+
+uint8_t hostFlash[HOST_FLASH_SIZE];
+uint8_t hostRtcMemory[HOST_RTC_MEMORY];
+uint32_t hostRtcWrites = 0;
+#if defined(ESP32)
+uint32_t hostResetReason = ESP_RST_POWERON;
+#else
+uint32_t hostResetReason = REASON_DEFAULT_RST;
+#endif
+
+uint32_t EspClass::getCycleCount()
+{
+	return hostNanos() * getCpuFreqMHz() / 1000;
+}
+
+// like the SDK: offset and size in bytes, a multiple of 4
+bool EspClass::flashRead(uint32_t offset, uint32_t *data, size_t size)
+{
+	if (offset + size > HOST_FLASH_SIZE)
+	{
+		return false;
+	}
+	memcpy(data, hostFlash + offset, size);
+	return true;
+}
+
+// NOR flash: writing can only clear bits
+bool EspClass::flashWrite(uint32_t offset, const uint32_t *data, size_t size)
+{
+	if (offset + size > HOST_FLASH_SIZE)
+	{
+		return false;
+	}
+	for (size_t i = 0; i < size; i++)
+	{
+		hostFlash[offset + i] &= ((const uint8_t *)data)[i];
+	}
+	return true;
+}
+
+bool EspClass::flashEraseSector(uint32_t sector)
+{
+	if ((sector + 1) * 4096 > HOST_FLASH_SIZE)
+	{
+		return false;
+	}
+	memset(hostFlash + sector * 4096, 0xFF, 4096);
+	return true;
+}
+
+// offset in 4 byte blocks
+bool EspClass::rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size)
+{
+	if (offset * 4 + size > HOST_RTC_MEMORY)
+	{
+		return false;
+	}
+	memcpy(data, hostRtcMemory + offset * 4, size);
+	return true;
+}
+
+bool EspClass::rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size)
+{
+	if (offset * 4 + size > HOST_RTC_MEMORY)
+	{
+		return false;
+	}
+	memcpy(hostRtcMemory + offset * 4, data, size);
+	hostRtcWrites++;
+	return true;
+}
+
+#if defined(ESP8266)
+volatile uint32_t hostGpioSet = 0;
+volatile uint32_t hostGpioClear = 0;
+
+struct rst_info *EspClass::getResetInfoPtr()
+{
+	static struct rst_info info;
+	info.reason = hostResetReason;
+	return &info;
+}
+#endif
+
+#if defined(ESP32)
+esp_reset_reason_t esp_reset_reason()
+{
+	return (esp_reset_reason_t)hostResetReason;
+}
+
+uint32_t hostLedcDuty[16];
+uint32_t hostLedcHpoint[16];
+static uint32_t pendingDuty[16];
+static uint32_t pendingHpoint[16];
+
+void ledcWrite(uint8_t channel, uint32_t duty)
+{
+	if (channel < 16)
+	{
+		hostLedcDuty[channel] = duty;
+	}
+}
+
+int ledc_set_duty_with_hpoint(ledc_mode_t mode, ledc_channel_t channel, uint32_t duty, uint32_t hpoint)
+{
+	pendingDuty[mode * 8 + channel] = duty;
+	pendingHpoint[mode * 8 + channel] = hpoint;
+	return 0;
+}
+
+int ledc_update_duty(ledc_mode_t mode, ledc_channel_t channel)
+{
+	hostLedcDuty[mode * 8 + channel] = pendingDuty[mode * 8 + channel];
+	hostLedcHpoint[mode * 8 + channel] = pendingHpoint[mode * 8 + channel];
+	return 0;
+}
+
+uint32_t hostRmtBytes = 0;
+
+esp_partition_t hostPartition = {0};
+static uint8_t partitionData[HOST_FLASH_SIZE];
+
+const esp_partition_t *esp_partition_find_first(int, int, const char *)
+{
+	return hostPartition.size > 0 ? &hostPartition : nullptr;
+}
+
+int esp_partition_read(const esp_partition_t *partition, size_t offset, void *data, size_t size)
+{
+	if (offset + size > partition->size || offset + size > HOST_FLASH_SIZE)
+	{
+		return -1;
+	}
+	memcpy(data, partitionData + offset, size);
+	return ESP_OK;
+}
+
+int esp_partition_write(const esp_partition_t *partition, size_t offset, const void *data, size_t size)
+{
+	if (offset + size > partition->size || offset + size > HOST_FLASH_SIZE)
+	{
+		return -1;
+	}
+	for (size_t i = 0; i < size; i++)
+	{
+		partitionData[offset + i] &= ((const uint8_t *)data)[i];
+	}
+	return ESP_OK;
+}
+
+int esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+	if (offset % 4096 != 0 || size % 4096 != 0 || offset + size > partition->size || offset + size > HOST_FLASH_SIZE)
+	{
+		return -1;
+	}
+	memset(partitionData + offset, 0xFF, size);
+	return ESP_OK;
+}
+#endif
@@ -0,0 +1,125 @@
+#include "check.h"
+#include "esp-knx-led-analyzer.h"
+
+// Flicker risk, visible steps and unevenness of KnxLedAnalyzer on known duty sequences
+
+// one duty per tick on channel 0, 10 bit
+static output_quality_t analyze(KnxLedAnalyzer &analyzer, const uint16_t *duties, uint16_t count)
+{
+	for (uint16_t i = 0; i < count; i++)
+	{
+		analyzer.write(0, duties[i]);
+		analyzer.tick();
+	}
+	return analyzer.getQuality();
+}
+
+// a constant duty is 100 % modulation, the risk class depends on the frequency only
+static void testFlickerRisk()
+{
+	const uint16_t half[] = {512, 512, 512, 512};
+	const uint32_t frequencies[] = {100, 1000, 2000, 4000};
+	const uint8_t risks[] = {FLICKER_HIGH_RISK, FLICKER_HIGH_RISK, FLICKER_LOW_RISK, FLICKER_NO_EFFECT};
+	for (uint8_t i = 0; i < 4; i++)
+	{
+		KnxLedAnalyzer analyzer(frequencies[i]);
+		output_quality_t quality = analyze(analyzer, half, 4);
+		CHECK_EQUAL(quality.ticks, 4);
+		CHECK_EQUAL(quality.flickerPercent, 100);
+		CHECK_EQUAL(quality.flickerRisk, risks[i]);
+		CHECK(fabsf(quality.flickerIndex - (1 - 512 / 1023.0f)) < 0.001f);
+	}
+
+	// full on and off don't modulate, the off ticks don't count for the flicker index
+	const uint16_t steady[] = {0, 1023, 1023, 0};
+	KnxLedAnalyzer analyzer(100);
+	output_quality_t quality = analyze(analyzer, steady, 4);
+	CHECK_EQUAL(quality.flickerPercent, 0);
+	CHECK_EQUAL(quality.flickerIndex, 0);
+	CHECK_EQUAL(quality.flickerRisk, FLICKER_NO_EFFECT);
+
+	// a quarter duty modulates more than half of the period
+	const uint16_t quarter[] = {0, 256, 256, 0};
+	analyzer.reset();
+	quality = analyze(analyzer, quarter, 4);
+	CHECK_EQUAL(quality.ticks, 4);
+	CHECK(fabsf(quality.flickerIndex - (1 - 256 / 1023.0f)) < 0.001f);
+}
+
+static void testSteps()
+{
+	// 8 jumps of 1/8 from off to full on, all above 1 L*. Above 8 L* only the first 4 are left
+	uint16_t jumps[9];
+	for (uint8_t i = 0; i < 9; i++)
+	{
+		jumps[i] = min(i * 128, 1023);
+	}
+	KnxLedAnalyzer analyzer(4000);
+	output_quality_t quality = analyze(analyzer, jumps, 9);
+	CHECK_EQUAL(quality.visibleSteps, 8);
+	CHECK(fabsf(quality.maxStep - KnxLedAnalyzer::lightness(128 / 1023.0f)) < 0.001f);
+	analyzer.reset();
+	analyzer.configStepThreshold(8);
+	CHECK_EQUAL(analyze(analyzer, jumps, 9).visibleSteps, 4);
+
+	// single duty steps of 10 bits stay below 1 L* over the whole range
+	uint16_t ramp[1024];
+	for (uint16_t i = 0; i < 1024; i++)
+	{
+		ramp[i] = i;
+	}
+	KnxLedAnalyzer smooth(4000);
+	quality = analyze(smooth, ramp, 1024);
+	CHECK_EQUAL(quality.visibleSteps, 0);
+	CHECK(quality.maxStep > 0.8f);
+	CHECK(quality.maxStep < 1);
+
+	// 8 bit PWM drops the low bits, so the same ramp steps by 4 and the dark end is visible
+	KnxLedAnalyzer coarse(4000, 8);
+	quality = analyze(coarse, ramp, 1024);
+	CHECK(quality.visibleSteps > 0);
+	CHECK(quality.visibleSteps < 255);
+	CHECK(fabsf(quality.maxStep - KnxLedAnalyzer::lightness(1 / 255.0f)) < 0.001f);
+
+	// a channel which isn't light isn't scored
+	KnxLedAnalyzer masked(4000);
+	masked.configLightChannels(0b10);
+	quality = analyze(masked, jumps, 9);
+	CHECK_EQUAL(quality.visibleSteps, 0);
+	CHECK_EQUAL(quality.maxStep, 0);
+	CHECK_EQUAL(quality.flickerPercent, 0);
+}
+
+// below 0.9 % luminance L* is linear, so equal duty steps are equal L* steps
+static void testUnevenness()
+{
+	KnxLedAnalyzer analyzer(4000);
+	for (uint16_t duty = 1; duty <= 9; duty++)
+	{
+		analyzer.write(0, duty);
+		analyzer.tick();
+		analyzer.tick();
+	}
+	CHECK(analyzer.getQuality().unevenness < 0.001f);
+
+	// gaps of 1 and 3 ticks alternate, the rate changes by 2/3 each time
+	analyzer.reset();
+	for (uint16_t duty = 1; duty <= 9; duty++)
+	{
+		analyzer.write(0, duty);
+		analyzer.tick();
+		for (uint8_t i = 0; i < (duty % 2 ? 0 : 2); i++)
+		{
+			analyzer.tick();
+		}
+	}
+	CHECK(fabsf(analyzer.getQuality().unevenness - 2 / 3.0f) < 0.001f);
+}
+
+int main()
+{
+	testFlickerRisk();
+	testSteps();
+	testUnevenness();
+	return checkResult("analyzer");
+}
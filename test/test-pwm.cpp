@@ -0,0 +1,94 @@
+#include "check.h"
+#include "esp-knx-led.h"
+
+// Frequency and resolution of KnxLed::solvePwm() for the clock models of the platforms
+
+typedef struct
+{
+	const pwm_clock_t &pwmClock;
+	uint32_t minFrequency;
+	uint8_t minResolution;
+	bool cameraSafe;
+	uint32_t frequency;
+	uint8_t resolution;
+	uint32_t steps;
+	bool satisfied;
+} pwm_case_t;
+
+static const pwm_case_t cases[] = {
+	// the examples of solvePwm()
+	{pwmClockEsp32, 1000, 10, false, 4882, 14, 16383, true},
+	{pwmClockEsp8266, 200, 10, false, 244, 12, 4095, true},
+	{pwmClockBeken, 1000, 10, false, 1587, 14, 16383, true},
+	// above the camera frequency the resolution drops
+	{pwmClockEsp32, 100, 10, true, 39062, 11, 2047, true},
+	{pwmClockEsp8266, 100, 4, true, 32258, 5, 31, true},
+	{pwmClockBeken, 100, 10, true, 25415, 10, 1023, true},
+	// the lowest frequency is raised to the minimum of the peripheral
+	{pwmClockEsp32, 0, 10, false, 4882, 14, 16383, true},
+	{pwmClockEsp8266, 10, 10, false, 122, 13, 8191, true},
+	{pwmClockBeken, 0, 16, false, 396, 16, 65535, true},
+	// the highest frequency is limited to the maximum of the peripheral
+	{pwmClockEsp32, 50000000, 1, false, 40000000, 1, 1, true},
+	{pwmClockEsp8266, 50000, 4, false, 40000, 4, 15, true},
+	{pwmClockBeken, 200000, 8, false, 100000, 8, 255, true},
+	// unsatisfiable: the frequency is kept. The LEDC drops the resolution, the others keep it with fewer steps
+	{pwmClockEsp32, 100000, 10, false, 100000, 9, 511, false},
+	{pwmClockEsp32, 40000000, 10, false, 40000000, 1, 1, false},
+	{pwmClockEsp8266, 1000, 12, false, 1000, 12, 1000, false},
+	{pwmClockEsp8266, 100, 17, false, 100, 16, 10000, false},
+	{pwmClockBeken, 100000, 10, false, 100000, 10, 260, false},
+};
+
+static void testCases()
+{
+	for (const pwm_case_t &c : cases)
+	{
+		pwm_config_t config = KnxLed::solvePwm(c.pwmClock, c.minFrequency, c.minResolution, c.cameraSafe);
+		CHECK_EQUAL(config.frequency, c.frequency);
+		CHECK_EQUAL(config.resolution, c.resolution);
+		CHECK_EQUAL(config.steps, c.steps);
+		CHECK_EQUAL(config.satisfied, c.satisfied);
+	}
+}
+
+// a satisfied solution has all steps of its resolution and is at least as fast as requested
+static void testSweep()
+{
+	const pwm_clock_t *clocks[] = {&pwmClockEsp32, &pwmClockEsp8266, &pwmClockBeken};
+	for (const pwm_clock_t *pwmClock : clocks)
+	{
+		for (uint32_t minFrequency = 1; minFrequency <= pwmClock->maxFrequency; minFrequency = minFrequency * 5 / 4 + 1)
+		{
+			for (uint8_t minResolution = 1; minResolution <= pwmClock->maxResolution; minResolution++)
+			{
+				pwm_config_t config = KnxLed::solvePwm(*pwmClock, minFrequency, minResolution);
+				uint32_t counts = pwmClock->fullPeriod ? 1UL << config.resolution : pwmClock->clock / config.frequency;
+				bool valid = config.frequency >= max(minFrequency, pwmClock->minFrequency) && config.frequency <= pwmClock->maxFrequency;
+				if (config.satisfied)
+				{
+					valid = valid && config.resolution >= minResolution && config.steps == (1UL << config.resolution) - 1;
+					valid = valid && counts >= (1UL << config.resolution) - 1;
+				}
+				else
+				{
+					valid = valid && config.steps < (1UL << minResolution) - 1;
+				}
+				if (!valid)
+				{
+					CHECK_EQUAL(minFrequency, -1);
+					CHECK_EQUAL(minResolution, -1);
+					return;
+				}
+			}
+		}
+	}
+	CHECK(true);
+}
+
+int main()
+{
+	testCases();
+	testSweep();
+	return checkResult("pwm");
+}
@@ -0,0 +1,296 @@
+#include "check.h"
+#include "esp-knx-led-storage.h"
+#if defined(ESP8266)
+#include <user_interface.h>
+#endif
+
+// Persistence of KnxLedStorage on simulated flash. A power cycle is simulated with new lights and a new storage on
+// the same flash content.
+
+static const uint8_t pins[] = {1, 2, 3};
+
+// writes after the byte budget are lost, like a power loss during a write
+class TornFlash : public KnxLedStorageBackend
+{
+public:
+	TornFlash(KnxLedStorageBackend &flash, size_t budget) : flash(flash), budget(budget) {}
+
+	size_t size() { return flash.size(); }
+	size_t sectorSize() { return flash.sectorSize(); }
+	bool read(size_t offset, void *data, size_t length) { return flash.read(offset, data, length); }
+	bool erase(size_t offset, size_t length) { return flash.erase(offset, length); }
+	bool write(size_t offset, const void *data, size_t length)
+	{
+		size_t written = min(length, budget);
+		budget -= written;
+		return flash.write(offset, data, written) && written == length;
+	}
+
+private:
+	KnxLedStorageBackend &flash;
+	size_t budget;
+};
+
+static void initLight(KnxLed &led, KnxLed::LightTypes lightType)
+{
+	led.configDefaultBrightness(0);
+	led.configDefaultTemperature(0);
+	led.configDefaultHsv({0, 0, 0});
+	if (lightType == KnxLed::TUNABLEWHITE)
+	{
+		led.initTunableWhiteLight(pins[0], pins[1], NORMAL);
+	}
+	else
+	{
+		led.initRgbLight(pins[0], pins[1], pins[2]);
+	}
+}
+
+// runs the lights and the storage with simulated time
+static void run(KnxLedStorage &storage, KnxLed *lights, uint8_t count, uint32_t ms)
+{
+	for (uint32_t t = 0; t < ms; t++)
+	{
+		hostAdvanceMillis(1);
+		for (uint8_t i = 0; i < count; i++)
+		{
+			lights[i].loop();
+		}
+		storage.loop();
+	}
+}
+
+static void testPowerCycle()
+{
+	KnxLedSimulatedFlash flash(4096, 2);
+	{
+		KnxLed lights[2];
+		initLight(lights[0], KnxLed::TUNABLEWHITE);
+		initLight(lights[1], KnxLed::RGB);
+		KnxLedStorage storage;
+		storage.addLight(&lights[0]);
+		storage.addLight(&lights[1]);
+		CHECK(storage.begin(&flash));
+
+		lights[0].switchLight(true);
+		lights[0].setBrightness(100);
+		lights[0].setTemperature(4000);
+		lights[0].learnScene(3);
+		lights[0].switchLight(false);
+		lights[1].setHsv({120, 200, 150});
+		lights[1].learnScene(5);
+		lights[1].switchLight(false);
+		run(storage, lights, 2, STORAGE_QUIET_TIME / 2);
+		CHECK_EQUAL(storage.getWriteCount(), 0);
+		run(storage, lights, 2, STORAGE_QUIET_TIME);
+		// all changes are written as one batch
+		CHECK_EQUAL(storage.getWriteCount(), 1);
+	}
+
+	KnxLed lights[2];
+	initLight(lights[0], KnxLed::TUNABLEWHITE);
+	initLight(lights[1], KnxLed::RGB);
+	KnxLedStorage storage;
+	storage.addLight(&lights[0]);
+	storage.addLight(&lights[1]);
+	CHECK(storage.begin(&flash));
+
+	lights[0].switchLight(true);
+	lights[1].switchLight(true);
+	run(storage, lights, 2, 2000);
+	CHECK_EQUAL(lights[0].getBrightness(), 100);
+	CHECK_EQUAL(lights[0].getTemperature(), 4000);
+	hsv_t hsv = lights[1].getHsv();
+	CHECK_EQUAL(hsv.h, 120);
+	CHECK_EQUAL(hsv.s, 200);
+	CHECK_EQUAL(hsv.v, 150);
+	scene_t scene;
+	CHECK(lights[0].getSceneData(3, scene));
+	CHECK_EQUAL(scene.v, 100);
+	CHECK_EQUAL(scene.temperature, (4000 - 2700) / 20);
+	CHECK(lights[1].getSceneData(5, scene));
+	CHECK_EQUAL(scene.temperature, SCENE_RGB);
+	CHECK_EQUAL(scene.h, 120);
+	CHECK(!lights[1].getSceneData(3, scene));
+	// nothing changed since the restore
+	run(storage, lights, 2, STORAGE_QUIET_TIME * 2);
+	CHECK_EQUAL(storage.getWriteCount(), 0);
+}
+
+// the halves are used alternately, so both are erased equally often
+static void testWear()
+{
+	KnxLedSimulatedFlash flash(1024, 2);
+	KnxLed light;
+	initLight(light, KnxLed::TUNABLEWHITE);
+	KnxLedStorage storage;
+	storage.addLight(&light);
+	storage.configQuietTime(STORAGE_POLL_INTERVAL);
+	CHECK(storage.begin(&flash));
+
+	light.switchLight(true);
+	for (uint16_t i = 0; i < 1000; i++)
+	{
+		light.setTemperature(2700 + (i % 100) * 20);
+		run(storage, &light, 1, STORAGE_POLL_INTERVAL * 3);
+	}
+	CHECK_EQUAL(storage.getWriteCount(), 1000);
+	// 127 records per half after the header
+	CHECK(flash.getEraseCount(0) >= 1000 / 127 / 2);
+	CHECK(abs((int32_t)flash.getEraseCount(0) - (int32_t)flash.getEraseCount(1)) <= 1);
+}
+
+// a record which was interrupted while writing is skipped, the values before it are restored
+static void testTornWrite()
+{
+	KnxLedSimulatedFlash flash(1024, 2);
+	{
+		KnxLed light;
+		initLight(light, KnxLed::TUNABLEWHITE);
+		KnxLedStorage storage;
+		storage.addLight(&light);
+		CHECK(storage.begin(&flash));
+		light.switchLight(true);
+		light.setTemperature(3000);
+		storage.flush();
+		CHECK_EQUAL(storage.getWriteCount(), 1);
+	}
+	{
+		KnxLed light;
+		initLight(light, KnxLed::TUNABLEWHITE);
+		TornFlash torn(flash, sizeof(storage_record_t) / 2);
+		KnxLedStorage storage;
+		storage.addLight(&light);
+		CHECK(storage.begin(&torn));
+		light.switchLight(true);
+		light.setTemperature(5000);
+		storage.flush();
+	}
+
+	KnxLed light;
+	initLight(light, KnxLed::TUNABLEWHITE);
+	KnxLedStorage storage;
+	storage.addLight(&light);
+	CHECK(storage.begin(&flash));
+	CHECK_EQUAL(light.getTemperature(), 3000);
+	// the log continues after the torn record
+	light.switchLight(true);
+	light.setTemperature(6000);
+	storage.flush();
+
+	KnxLed restored;
+	initLight(restored, KnxLed::TUNABLEWHITE);
+	KnxLedStorage restoredStorage;
+	restoredStorage.addLight(&restored);
+	CHECK(restoredStorage.begin(&flash));
+	CHECK_EQUAL(restored.getTemperature(), 6000);
+}
+
+// a compaction which doesn't fit into a half keeps the old half active
+static void testCompactFailure()
+{
+	KnxLedSimulatedFlash flash(1024, 2);
+	{
+		KnxLed lights[2];
+		initLight(lights[0], KnxLed::TUNABLEWHITE);
+		initLight(lights[1], KnxLed::TUNABLEWHITE);
+		KnxLedStorage storage;
+		storage.addLight(&lights[0]);
+		CHECK(storage.begin(&flash));
+		lights[0].switchLight(true);
+		lights[0].setTemperature(3500);
+		for (uint8_t scene = 0; scene < SCENE_COUNT; scene++)
+		{
+			lights[0].learnScene(scene);
+		}
+		storage.flush();
+
+		// added after begin(), so the size check is bypassed and the scenes of both lights don't fit into a half
+		storage.addLight(&lights[1]);
+		lights[1].switchLight(true);
+		for (uint8_t scene = 0; scene < SCENE_COUNT; scene++)
+		{
+			lights[1].learnScene(scene);
+		}
+		lights[0].setTemperature(6000);
+		storage.flush();
+		CHECK_EQUAL(storage.getWriteCount(), 2);
+	}
+
+	KnxLed light;
+	initLight(light, KnxLed::TUNABLEWHITE);
+	KnxLedStorage storage;
+	storage.addLight(&light);
+	CHECK(storage.begin(&flash));
+	CHECK_EQUAL(light.getTemperature(), 3500);
+	scene_t scene;
+	CHECK(light.getSceneData(SCENE_COUNT - 1, scene));
+}
+
+static void copySnapshot(uint8_t fromSlot, uint8_t toSlot)
+{
+#if defined(ESP32)
+	uint8_t *snapshots = __start_host_rtc_noinit;
+#else
+	uint8_t *snapshots = hostRtcMemory + SNAPSHOT_RTC_BLOCK * 4;
+#endif
+	memcpy(snapshots + toSlot * sizeof(snapshot_t), snapshots + fromSlot * sizeof(snapshot_t), sizeof(snapshot_t));
+}
+
+// the snapshot of a warm restart is newer than the flash and wins, also for a light which is off. A cold start
+// restores the flash
+static void testWarmRestart()
+{
+	KnxLedSimulatedFlash flash(4096, 2);
+	{
+		KnxLed light;
+		light.configWarmRestart(true);
+		initLight(light, KnxLed::TUNABLEWHITE);
+		KnxLedStorage storage;
+		storage.addLight(&light);
+		CHECK(storage.begin(&flash));
+		light.switchLight(true);
+		light.setTemperature(3000);
+		storage.flush();
+		light.setTemperature(5000);
+		run(storage, &light, 1, 2000);
+		// the flash isn't written before the quiet time has passed
+		light.switchLight(false);
+		run(storage, &light, 1, 2000);
+	}
+
+	for (uint8_t warm = 0; warm < 2; warm++)
+	{
+		// the light gets the next slot, after a real restart it would get slot 0 again
+		copySnapshot(0, 1 + warm);
+#if defined(ESP32)
+		hostResetReason = warm ? ESP_RST_SW : ESP_RST_POWERON;
+#else
+		hostResetReason = warm ? REASON_SOFT_RESTART : REASON_DEFAULT_RST;
+#endif
+		KnxLed light;
+		light.configWarmRestart(true);
+		initLight(light, KnxLed::TUNABLEWHITE);
+		KnxLedStorage storage;
+		storage.addLight(&light);
+		CHECK(storage.begin(&flash));
+		CHECK_EQUAL(light.getBrightness(), 0);
+		CHECK_EQUAL(light.getTemperature(), warm ? 5000 : 3000);
+	}
+#if defined(ESP32)
+	hostResetReason = ESP_RST_POWERON;
+#else
+	hostResetReason = REASON_DEFAULT_RST;
+#endif
+}
+
+int main()
+{
+	hostSetMicros(0);
+	testPowerCycle();
+	testWear();
+	testTornWrite();
+	testCompactFailure();
+	testWarmRestart();
+	return checkResult("storage");
+}
@@ -0,0 +1,141 @@
+#include "check.h"
+#include "esp-knx-led-trace.h"
+#include <string>
+#include <vector>
+
+// Dump, parse and replay of KnxLedTrace with an effect and a synchronised transition
+
+static const uint8_t pins[] = {1, 2, 3};
+
+class TextOutput : public Print
+{
+public:
+	std::string text;
+
+	size_t write(uint8_t c)
+	{
+		text += (char)c;
+		return 1;
+	}
+};
+
+static void initLight(KnxLed &led)
+{
+	led.configSyncedTransition(400);
+	led.initRgbLight(pins[0], pins[1], pins[2]);
+}
+
+// the light runs with the tick interval of the replay, so the replayed duties are the recorded ones
+static void record(KnxLedTrace &trace)
+{
+	KnxLed led;
+	initLight(led);
+	led.attachTrace(&trace);
+	for (uint16_t tick = 0; tick < 600; tick++)
+	{
+		switch (tick)
+		{
+		case 0:
+			led.switchLight(true);
+			break;
+		case 50:
+			led.setHsv({100, 255, 200});
+			break;
+		case 120:
+			led.setEffect(KnxLed::EFFECT_COLORLOOP);
+			break;
+		case 400:
+			led.setEffect(KnxLed::EFFECT_NONE);
+			break;
+		case 420:
+			led.setBrightness(30);
+			break;
+		}
+		hostAdvanceMillis(TRACE_TICK_INTERVAL);
+		led.loop();
+	}
+	led.attachTrace(nullptr);
+}
+
+static std::string replay(KnxLedTrace &trace)
+{
+	KnxLed led;
+	initLight(led);
+	TextOutput csv;
+	trace.replay(led, csv, 100);
+	return csv.text;
+}
+
+int main()
+{
+	hostSetMicros(1000000);
+	KnxLedTrace trace(4096);
+	record(trace);
+	CHECK(trace.getCount() > 400);
+	CHECK(trace.getCount() < 4096);
+
+	// dump and parse give the same entries
+	TextOutput dump;
+	trace.dump(dump);
+	KnxLedTrace parsed(4096);
+	size_t start = 0;
+	for (size_t end = dump.text.find('\n'); end != std::string::npos; end = dump.text.find('\n', start))
+	{
+		CHECK(parsed.parse(dump.text.substr(start, end - start).c_str()));
+		start = end + 1;
+	}
+	CHECK(!parsed.parse("1,2,3"));
+	CHECK(!parsed.parse("1,99,0,0,0"));
+	CHECK_EQUAL(parsed.getCount(), trace.getCount());
+	for (uint16_t i = 0; i < trace.getCount(); i++)
+	{
+		trace_entry_t a = trace.getEntry(i);
+		trace_entry_t b = parsed.getEntry(i);
+		if (a.tick != b.tick || a.type != b.type || memcmp(a.data, b.data, sizeof(a.data)) != 0)
+		{
+			CHECK_EQUAL(i, -1);
+			break;
+		}
+	}
+
+	// the replay doesn't depend on the time and the shared clock
+	std::string first = replay(parsed);
+	hostAdvanceMillis(12345);
+	KnxLed::setClock(777);
+	std::string second = replay(parsed);
+	CHECK(first == second);
+	CHECK_EQUAL(KnxLed::getClock(), 777);
+
+	// every recorded duty is in the replay
+	std::vector<std::vector<unsigned int>> rows;
+	start = first.find('\n') + 1;
+	for (size_t end = first.find('\n', start); end != std::string::npos; end = first.find('\n', start))
+	{
+		std::vector<unsigned int> row(6);
+		CHECK_EQUAL(sscanf(first.c_str() + start, "%u,%u,%u,%u,%u,%u", &row[0], &row[1], &row[2], &row[3], &row[4], &row[5]), 6);
+		rows.push_back(row);
+		start = end + 1;
+	}
+	// up to the last command and the extra ticks
+	CHECK_EQUAL(rows.size(), 420 + 100);
+	uint16_t duties = 0;
+	for (uint16_t i = 0; i < trace.getCount(); i++)
+	{
+		trace_entry_t entry = trace.getEntry(i);
+		if (entry.type != TRACE_DUTY || entry.tick == 0)
+		{
+			continue;
+		}
+		const std::vector<unsigned int> &row = rows[entry.tick - 1];
+		if (row[0] != entry.tick || row[1 + entry.data[0]] != (unsigned int)(entry.data[1] | entry.data[2] << 8))
+		{
+			CHECK_EQUAL(entry.tick, -1);
+			break;
+		}
+		duties++;
+	}
+	// the effect changes the duties in most ticks
+	CHECK(duties > 400);
+
+	return checkResult("trace");
+}